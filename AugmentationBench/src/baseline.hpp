@@ -0,0 +1,276 @@
+#pragma once
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "synthetic_corpus.hpp"
+
+namespace program
+{
+    /**
+     * @brief Reads the numbers of a json document into dotted keys, {"a":{"b":1}} becomes "a.b" = 1.
+     * Strings, booleans and null are skipped, arrays are rejected. Enough for the baseline and for the
+     * throughput.json of the app, not a general json parser.
+     */
+    class flat_json final
+    {
+        const char* m_text;
+        std::map<std::string, double>& m_values;
+
+    public:
+        static bool parse(const std::string& text, std::map<std::string, double>& values)
+        {
+            flat_json parser(text.c_str(), values);
+            if (!parser.value(""))
+                return false;
+
+            parser.skip_space();
+
+            return !*parser.m_text;
+        }
+
+    private:
+        flat_json(const char* text, std::map<std::string, double>& values) :
+            m_text(text), m_values(values)
+        {
+
+        }
+
+        void skip_space()
+        {
+            while (isspace((unsigned char)*m_text))
+                m_text++;
+        }
+
+        bool string(std::string& out)
+        {
+            if (*m_text != '"')
+                return false;
+
+            for (m_text++; *m_text && *m_text != '"'; m_text++)
+            {
+                if (*m_text == '\\' && m_text[1])
+                    m_text++;
+                out += *m_text;
+            }
+            if (*m_text != '"')
+                return false;
+            m_text++;
+
+            return true;
+        }
+
+        bool value(const std::string& key)
+        {
+            this->skip_space();
+            if (*m_text == '{')
+            {
+                m_text++;
+                this->skip_space();
+                if (*m_text == '}')
+                {
+                    m_text++;
+
+                    return true;
+                }
+
+                for (;;)
+                {
+                    this->skip_space();
+                    std::string name;
+                    if (!this->string(name))
+                        return false;
+
+                    this->skip_space();
+                    if (*m_text++ != ':' || !this->value(key.empty() ? name : key + "." + name))
+                        return false;
+
+                    this->skip_space();
+                    if (*m_text == ',')
+                        m_text++;
+                    else
+                        return *m_text++ == '}';
+                }
+            }
+
+            if (*m_text == '"')
+            {
+                std::string ignored;
+
+                return this->string(ignored);
+            }
+
+            for (const char* word : { "true", "false", "null" })
+                if (!strncmp(m_text, word, strlen(word)))
+                {
+                    m_text += strlen(word);
+
+                    return true;
+                }
+
+            char* end = nullptr;
+            const double number = strtod(m_text, &end);
+            if (end == m_text)
+                return false;
+
+            m_values[key] = number;
+            m_text = end;
+
+            return true;
+        }
+    };
+
+    enum class metric_kind
+    {
+        // rows per second, higher is better
+        throughput,
+        // lower is better
+        time,
+        memory
+    };
+
+    /**
+     * @brief Checked in reference numbers of the benchmark and how far a run may fall behind them.
+     * Thresholds are relative and apply per kind of metric, derived from the name: *_per_second is throughput,
+     * *_seconds time and *_bytes memory.
+     */
+    struct baseline
+    {
+        corpus_config m_corpus;
+        std::map<std::string, double> m_thresholds{ { "throughput", 0.10 }, { "time", 0.15 }, { "memory", 0.15 } };
+        std::map<std::string, double> m_metrics;
+
+        static metric_kind kind(const std::string& metric)
+        {
+            auto ends_with = [&](const char* suffix)
+            {
+                const size_t length = strlen(suffix);
+
+                return metric.size() >= length && !metric.compare(metric.size() - length, length, suffix);
+            };
+
+            if (ends_with("_per_second"))
+                return metric_kind::throughput;
+
+            return ends_with("_bytes") ? metric_kind::memory : metric_kind::time;
+        }
+
+        static const char* kind_name(metric_kind kind)
+        {
+            switch (kind)
+            {
+            case metric_kind::throughput: return "throughput";
+            case metric_kind::time: return "time";
+            case metric_kind::memory: return "memory";
+            }
+
+            return "?";
+        }
+
+        /**
+         * @return false when the file is missing, can't be read or isn't valid json
+         */
+        bool load(const std::filesystem::path& file)
+        {
+            std::ifstream stream(file);
+            std::stringstream text;
+            text << stream.rdbuf();
+
+            std::map<std::string, double> values;
+            if (!stream || !flat_json::parse(text.str(), values))
+                return false;
+
+            for (const auto& [key, value] : values)
+            {
+                if (key == "corpus.symbols")
+                    m_corpus.m_symbols = (size_t)value;
+                else if (key == "corpus.rows")
+                    m_corpus.m_rows = (size_t)value;
+                else if (key == "corpus.seed")
+                    m_corpus.m_seed = (uint64_t)value;
+                else if (!key.compare(0, 11, "thresholds."))
+                    m_thresholds[key.substr(11)] = value;
+                else if (!key.compare(0, 8, "metrics."))
+                    m_metrics[key.substr(8)] = value;
+            }
+
+            return true;
+        }
+
+        bool save(const std::filesystem::path& file) const
+        {
+            std::ofstream stream(file, std::ios::trunc);
+            stream << "{\n    \"corpus\": { \"symbols\": " << m_corpus.m_symbols << ", \"rows\": " << m_corpus.m_rows << ", \"seed\": " << m_corpus.m_seed << " },\n";
+
+            stream << "    \"thresholds\": {";
+            const char* separator = " ";
+            for (const auto& [key, value] : m_thresholds)
+            {
+                stream << separator << '"' << key << "\": " << value;
+                separator = ", ";
+            }
+            stream << " },\n";
+
+            stream << "    \"metrics\": {";
+            separator = "\n";
+            char buffer[256];
+            for (const auto& [key, value] : m_metrics)
+            {
+                snprintf(buffer, sizeof(buffer), "%s        \"%s\": %.6g", separator, key.c_str(), value);
+                stream << buffer;
+                separator = ",\n";
+            }
+            stream << (m_metrics.empty() ? "}\n}\n" : "\n    }\n}\n");
+
+            return (bool)stream;
+        }
+
+        /**
+         * @brief Prints one line per metric with the baseline, the current value, the change and the verdict.
+         * @param unrecorded receives the number of metrics without a baseline value, they can't be judged
+         * @return number of metrics that regressed beyond their threshold
+         */
+        size_t compare(const std::map<std::string, double>& current, size_t& unrecorded) const
+        {
+            unrecorded = 0;
+            size_t regressions = 0;
+            printf("%-44s %14s %14s %9s %8s\n", "metric", "baseline", "current", "change", "limit");
+
+            for (const auto& [metric, value] : current)
+            {
+                const auto reference = m_metrics.find(metric);
+                if (reference == m_metrics.end() || reference->second <= 0.0)
+                {
+                    printf("%-44s %14s %14.6g %9s %8s  no baseline\n", metric.c_str(), "-", value, "-", "-");
+                    unrecorded++;
+
+                    continue;
+                }
+
+                const metric_kind metric_type = kind(metric);
+                const auto threshold = m_thresholds.find(kind_name(metric_type));
+                const double limit = threshold == m_thresholds.end() ? 0.10 : threshold->second;
+                const double change = value / reference->second - 1.0;
+                // throughput may not drop, time and memory may not grow by more than the limit
+                const bool regressed = metric_type == metric_kind::throughput ? change < -limit : change > limit;
+                regressions += regressed;
+
+                printf("%-44s %14.6g %14.6g %+8.1f%% %7s%.3g%%  %s\n", metric.c_str(), reference->second, value, change * 100.0,
+                    metric_type == metric_kind::throughput ? "-" : "+", limit * 100.0, regressed ? "REGRESSION" : "ok");
+            }
+
+            for (const auto& [metric, value] : m_metrics)
+                if (!current.count(metric))
+                    printf("%-44s %14.6g %14s %9s %8s  missing\n", metric.c_str(), value, "-", "-", "-");
+
+            return regressions;
+        }
+    };
+}
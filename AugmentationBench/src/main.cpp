@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "baseline.hpp"
+#include "synthetic_corpus.hpp"
+#include "augmentation/cross_asset.hpp"
+#include "augmentation/indicators.hpp"
+#include "augmentation/labels.hpp"
+#include "augmentation/normalization.hpp"
+
+extern char** environ;
+
+namespace program
+{
+    struct bench_options
+    {
+        std::filesystem::path m_baseline;
+        std::filesystem::path m_app = "bin/Release/AugmentationCPP";
+        // every measurement keeps its best of m_repeat runs, which filters most of the scheduling noise
+        size_t m_repeat = 3;
+        bool m_update = false;
+        bool m_skip_pipeline = false;
+        std::map<std::string, double> m_thresholds;
+    };
+
+    // flags of the end to end run, they cover every stage without depending on a reference symbol
+    static const std::vector<std::string> s_pipeline_flags{ "--progress", "0", "--normalize", "zscore", "--label-horizon", "5" };
+    // flags of the streaming check, without the gap repair and sidecars a streamed file leaves out
+    static const std::vector<std::string> s_streaming_flags{ "--progress", "0", "--normalize", "zscore" };
+
+    /**
+     * @brief Best rows per second of fn over repeat runs, prepare is called untimed before every run.
+     */
+    static double best_rate(size_t rows, size_t repeat, const std::function<void()>& prepare, const std::function<void()>& fn)
+    {
+        double best = 0.0;
+        for (size_t r = 0; r < repeat; r++)
+        {
+            prepare();
+            const auto begin = std::chrono::steady_clock::now();
+            fn();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            best = std::max(best, seconds > 0.0 ? rows / seconds : 0.0);
+        }
+
+        return best;
+    }
+
+    /**
+     * @brief Times the kernels of AugmentationLib on the first two symbols of the corpus, in memory.
+     */
+    static void run_micro(const corpus_config& config, size_t repeat, std::map<std::string, double>& metrics)
+    {
+        synthetic_corpus corpus(config.m_seed);
+        const synthetic_symbol symbol = corpus.generate(config.m_rows);
+        const synthetic_symbol reference_symbol = corpus.generate(config.m_rows);
+        const size_t rows = config.m_rows;
+        auto nothing = [] {};
+
+        std::vector<double> columns(10 * rows);
+        indicator_job job;
+        job.m_input = { symbol.m_high.data(), symbol.m_low.data(), symbol.m_close.data(), symbol.m_volume.data(), rows };
+        double** outputs[] = { &job.m_output.m_adosc, &job.m_output.m_atr, &job.m_output.m_macd, &job.m_output.m_macd_signal,
+            &job.m_output.m_macd_hist, &job.m_output.m_mfi, &job.m_output.m_upper_band, &job.m_output.m_middle_band,
+            &job.m_output.m_lower_band, &job.m_output.m_rsi };
+        for (size_t c = 0; c < std::size(outputs); c++)
+            *outputs[c] = columns.data() + c * rows;
+        metrics["micro.indicators.rows_per_second"] = best_rate(rows, repeat, nothing, [&]
+        {
+            job.m_status = compute_indicators(job.m_input, job.m_output);
+        });
+        if (job.m_status != compute_status::success)
+            fprintf(stderr, "Computing the indicators failed: %s\n", to_string(job.m_status));
+
+        // the five prices row by row, normalized in place
+        std::vector<double> prices(5 * rows);
+        metrics["micro.normalize_zscore.rows_per_second"] = best_rate(rows, repeat, [&]
+        {
+            for (size_t i = 0; i < rows; i++)
+            {
+                prices[i * 5 + 0] = symbol.m_open[i];
+                prices[i * 5 + 1] = symbol.m_close[i];
+                prices[i * 5 + 2] = symbol.m_high[i];
+                prices[i * 5 + 3] = symbol.m_low[i];
+                prices[i * 5 + 4] = symbol.m_volume[i];
+            }
+        }, [&]
+        {
+            rolling_normalizer normalizer(normalization_mode::zscore, 100, 5);
+            normalizer.update(prices.data(), rows, 5);
+        });
+
+        std::vector<double> returns(rows);
+        metrics["micro.forward_returns.rows_per_second"] = best_rate(rows, repeat, nothing, [&]
+        {
+            forward_returns(symbol.m_close.data(), rows, 5, returns.data());
+        });
+
+        std::vector<int8_t> labels(rows);
+        std::vector<uint32_t> offsets(rows);
+        label_config barriers;
+        barriers.m_horizon = 60;
+        barriers.m_upper_barrier = 0.01;
+        barriers.m_lower_barrier = 0.01;
+        metrics["micro.barrier_labels.rows_per_second"] = best_rate(rows, repeat, nothing, [&]
+        {
+            barrier_labels(symbol.m_close.data(), rows, barriers, labels.data(), offsets.data());
+        });
+
+        const reference_series reference("REF", reference_symbol.m_timestamps, reference_symbol.m_close);
+        const std::vector<size_t> windows{ 30, 240 };
+        std::vector<double> cross(cross_asset_features::feature_count * windows.size() * rows);
+        metrics["micro.cross_asset.rows_per_second"] = best_rate(rows, repeat, nothing, [&]
+        {
+            cross_asset_features::compute(symbol.m_timestamps.data(), symbol.m_close.data(), rows, reference, windows, cross.data());
+        });
+    }
+
+    /**
+     * @brief Runs the app on the corpus as a child process, its output is discarded.
+     * @return false when it couldn't be started or didn't exit with 0
+     */
+    static bool spawn_app(const bench_options& options, const std::filesystem::path& input, const std::filesystem::path& output,
+        const std::vector<std::string>& flags, rusage& usage)
+    {
+        std::vector<std::string> arguments{ options.m_app.string(), input.string(), output.string() };
+        arguments.insert(arguments.end(), flags.begin(), flags.end());
+
+        std::vector<char*> argv;
+        for (std::string& argument : arguments)
+            argv.push_back(argument.data());
+        argv.push_back(nullptr);
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+        posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+        pid_t pid;
+        const int error = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if (error)
+        {
+            fprintf(stderr, "Failed to start %s: %s\n", argv[0], strerror(error));
+
+            return false;
+        }
+
+        int status = 0;
+        if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status))
+        {
+            fprintf(stderr, "%s failed, run it on %s by hand to see why.\n", argv[0], input.c_str());
+
+            return false;
+        }
+
+        return true;
+    }
+
+    static bool same_content(const std::filesystem::path& a, const std::filesystem::path& b)
+    {
+        std::ifstream first(a, std::ios::binary), second(b, std::ios::binary);
+        if (!first || !second)
+            return false;
+
+        std::istreambuf_iterator<char> end;
+        return std::equal(std::istreambuf_iterator<char>(first), end, std::istreambuf_iterator<char>(second), end);
+    }
+
+    /**
+     * @brief Runs the app on the corpus once in memory and once with a memory budget of one byte, which streams every
+     * file, and compares the .bin outputs byte for byte.
+     * @param mismatches receives the number of outputs that differ
+     * @return false when the app couldn't be run
+     */
+    static bool check_streaming(const bench_options& options, const std::filesystem::path& input, const std::filesystem::path& folder, size_t& mismatches)
+    {
+        const std::filesystem::path batch = folder / "batch";
+        const std::filesystem::path streamed = folder / "streamed";
+        std::filesystem::create_directories(batch);
+        std::filesystem::create_directories(streamed);
+
+        std::vector<std::string> streaming_flags = s_streaming_flags;
+        streaming_flags.insert(streaming_flags.end(), { "--memory-budget", "1" });
+
+        rusage usage{};
+        if (!spawn_app(options, input, batch, s_streaming_flags, usage) || !spawn_app(options, input, streamed, streaming_flags, usage))
+            return false;
+
+        mismatches = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(batch))
+            if (entry.path().extension() == ".bin" && !same_content(entry.path(), streamed / entry.path().filename()))
+            {
+                printf("Streamed output %s differs from the batch output.\n", entry.path().filename().c_str());
+                mismatches++;
+            }
+
+        return true;
+    }
+
+    /**
+     * @brief End to end runs of the app on the corpus written as CSV files.
+     * Rows per second come from the wall clock of the app, the stage times from its throughput.json (summed
+     * over the workers) and the peak RSS from the rusage of the child. Afterwards the streamed and batch outputs are compared.
+     */
+    static bool run_pipeline(const bench_options& options, const corpus_config& config, std::map<std::string, double>& metrics, size_t& mismatches)
+    {
+        const std::filesystem::path folder = std::filesystem::temp_directory_path() / ("augmentation-bench-" + std::to_string(getpid()));
+        const std::filesystem::path input = folder / "input";
+        const std::filesystem::path output = folder / "output";
+        std::filesystem::create_directories(input);
+
+        bool success = synthetic_corpus::write_csv(config, input);
+        if (!success)
+            fprintf(stderr, "Failed to write the corpus to %s.\n", input.c_str());
+
+        std::map<std::string, double> best;
+        for (size_t r = 0; success && r < options.m_repeat; r++)
+        {
+            std::filesystem::remove_all(output);
+            std::filesystem::create_directories(output);
+
+            rusage usage{};
+            if (!(success = spawn_app(options, input, output, s_pipeline_flags, usage)))
+                break;
+
+            std::map<std::string, double> summary;
+            std::ifstream stream(output / "throughput.json");
+            std::stringstream text;
+            text << stream.rdbuf();
+            if (!(success = flat_json::parse(text.str(), summary) && summary["seconds"] > 0.0))
+            {
+                fprintf(stderr, "%s didn't write a valid throughput.json.\n", options.m_app.c_str());
+
+                break;
+            }
+
+            const std::map<std::string, double> run
+            {
+                { "pipeline.rows_per_second", summary["stages.write.rows"] / summary["seconds"] },
+                { "pipeline.peak_rss_bytes", usage.ru_maxrss * 1024.0 },
+                { "pipeline.read_seconds", summary["stages.read.busy_seconds"] },
+                { "pipeline.compute_seconds", summary["stages.compute.busy_seconds"] },
+                { "pipeline.write_seconds", summary["stages.write.busy_seconds"] }
+            };
+            for (const auto& [metric, value] : run)
+            {
+                const bool higher_is_better = baseline::kind(metric) == metric_kind::throughput;
+                if (!best.count(metric) || (higher_is_better ? value > best[metric] : value < best[metric]))
+                    best[metric] = value;
+            }
+        }
+
+        if (success)
+            success = check_streaming(options, input, folder, mismatches);
+
+        std::error_code code;
+        std::filesystem::remove_all(folder, code);
+        metrics.insert(best.begin(), best.end());
+
+        return success;
+    }
+
+    static bool parse_options(int argc, char** argv, bench_options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const char* flag = argv[i];
+            const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+            if (!strcmp(flag, "--update"))
+                options.m_update = true;
+            else if (!strcmp(flag, "--skip-pipeline"))
+                options.m_skip_pipeline = true;
+            else if (!strcmp(flag, "--app") && value)
+            {
+                options.m_app = value;
+
+                i++;
+            }
+            else if (!strcmp(flag, "--repeat") && value)
+            {
+                if (sscanf(value, "%zu", &options.m_repeat) != 1 || !options.m_repeat)
+                    return false;
+
+                i++;
+            }
+            else if (!strcmp(flag, "--threshold") && value)
+            {
+                // kind=fraction, e.g. throughput=0.05
+                const char* separator = strchr(value, '=');
+                double fraction = 0.0;
+                if (!separator || sscanf(separator + 1, "%lf", &fraction) != 1)
+                    return false;
+                options.m_thresholds[std::string(value, separator)] = fraction;
+
+                i++;
+            }
+            else if (flag[0] != '-' && options.m_baseline.empty())
+                options.m_baseline = flag;
+            else
+                return false;
+        }
+
+        return !options.m_baseline.empty();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    using namespace program;
+
+    bench_options options;
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr, "Usage: %s [--app PATH] [--repeat N] [--threshold KIND=FRACTION] [--skip-pipeline] [--update] baseline.json\n", argv[0]);
+
+        return 2;
+    }
+
+    // only --update may start a baseline from scratch, a comparison without one would pass anything
+    baseline reference;
+    if (!(options.m_update && !std::filesystem::exists(options.m_baseline)) && !reference.load(options.m_baseline))
+    {
+        fprintf(stderr, "Failed to read the baseline %s.\n", options.m_baseline.c_str());
+
+        return 2;
+    }
+    for (const auto& [kind, fraction] : options.m_thresholds)
+        reference.m_thresholds[kind] = fraction;
+
+    printf("Corpus: %zu symbols of %zu rows, seed %llu, best of %zu runs.\n\n", reference.m_corpus.m_symbols, reference.m_corpus.m_rows,
+        (unsigned long long)reference.m_corpus.m_seed, options.m_repeat);
+
+    std::map<std::string, double> metrics;
+    size_t mismatches = 0;
+    run_micro(reference.m_corpus, options.m_repeat, metrics);
+    if (!options.m_skip_pipeline && !run_pipeline(options, reference.m_corpus, metrics, mismatches))
+        return 2;
+    if (mismatches)
+    {
+        fprintf(stderr, "\n%zu streamed output(s) differ from the batch path.\n", mismatches);
+
+        return 1;
+    }
+
+    size_t unrecorded = 0;
+    const size_t regressions = reference.compare(metrics, unrecorded);
+    if (options.m_update)
+    {
+        reference.m_metrics = metrics;
+        if (!reference.save(options.m_baseline))
+        {
+            fprintf(stderr, "Failed to write the baseline %s.\n", options.m_baseline.c_str());
+
+            return 2;
+        }
+        printf("\nBaseline %s updated.\n", options.m_baseline.c_str());
+
+        return 0;
+    }
+
+    if (regressions)
+        printf("\n%zu metric(s) regressed beyond their threshold.\n", regressions);
+    if (unrecorded)
+    {
+        fprintf(stderr, "\n%zu metric(s) have no baseline value, record the baseline first with --update on the reference host.\n", unrecorded);
+
+        return 2;
+    }
+
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace program
+{
+    // shape of the corpus, stored in the baseline so every comparison runs on the same data
+    struct corpus_config
+    {
+        size_t m_symbols = 4;
+        size_t m_rows = 250000;
+        uint64_t m_seed = 1;
+    };
+
+    // one symbol of the corpus, in the column layout of AugmentationLib
+    struct synthetic_symbol
+    {
+        std::vector<uint64_t> m_timestamps;
+        std::vector<double> m_open, m_close, m_high, m_low, m_volume;
+    };
+
+    /**
+     * @brief Deterministic one minute candles: a random walk of log returns with wicks and volume around it.
+     * The generator is splitmix64 with its own uniform mapping, so the data is identical on every platform
+     * and standard library, unlike the distributions of <random>.
+     */
+    class synthetic_corpus final
+    {
+        uint64_t m_state;
+
+    public:
+        explicit synthetic_corpus(uint64_t seed) :
+            m_state(seed)
+        {
+
+        }
+
+        synthetic_symbol generate(size_t rows)
+        {
+            synthetic_symbol symbol;
+            symbol.m_timestamps.resize(rows);
+            symbol.m_open.resize(rows);
+            symbol.m_close.resize(rows);
+            symbol.m_high.resize(rows);
+            symbol.m_low.resize(rows);
+            symbol.m_volume.resize(rows);
+
+            double price = 100.0 + 900.0 * this->uniform();
+            for (size_t i = 0; i < rows; i++)
+            {
+                const double open = price;
+                price *= std::exp((this->uniform() - 0.5) * 0.004);
+
+                symbol.m_timestamps[i] = 1609459200000ull + i * 60000ull;
+                symbol.m_open[i] = open;
+                symbol.m_close[i] = price;
+                symbol.m_high[i] = std::max(open, price) * (1.0 + 0.001 * this->uniform());
+                symbol.m_low[i] = std::min(open, price) * (1.0 - 0.001 * this->uniform());
+                symbol.m_volume[i] = 10.0 + 1000.0 * this->uniform();
+            }
+
+            return symbol;
+        }
+
+        /**
+         * @brief Writes every symbol as SYM<i>.csv with the default column names of the app.
+         */
+        static bool write_csv(const corpus_config& config, const std::filesystem::path& folder)
+        {
+            synthetic_corpus corpus(config.m_seed);
+            for (size_t s = 0; s < config.m_symbols; s++)
+            {
+                const synthetic_symbol symbol = corpus.generate(config.m_rows);
+                const std::filesystem::path file = folder / ("SYM" + std::to_string(s) + ".csv");
+
+                FILE* stream = fopen(file.c_str(), "w");
+                if (!stream)
+                    return false;
+
+                fputs("event_time,open,close,high,low,volume\n", stream);
+                for (size_t i = 0; i < config.m_rows; i++)
+                    fprintf(stream, "%llu,%.6f,%.6f,%.6f,%.6f,%.4f\n", (unsigned long long)symbol.m_timestamps[i],
+                        symbol.m_open[i], symbol.m_close[i], symbol.m_high[i], symbol.m_low[i], symbol.m_volume[i]);
+
+                if (fclose(stream))
+                    return false;
+            }
+
+            return true;
+        }
+
+    private:
+        // [0, 1) from the top 53 bits of splitmix64
+        double uniform()
+        {
+            uint64_t z = (m_state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            z ^= z >> 31;
+
+            return (z >> 11) * 0x1.0p-53;
+        }
+    };
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Hot loops are compiled once per ISA level and the best clone is picked when the binary is loaded
+// (cpuid through an ifunc resolver), so one build runs with full vector width on every host.
+// Define AUGMENTATION_NO_DISPATCH to build only the baseline version, e.g. for toolchains without ifunc.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__linux__) && !defined(AUGMENTATION_NO_DISPATCH)
+#define AUGMENTATION_KERNEL __attribute__((target_clones("default", "sse4.2", "avx2", "avx512f")))
+#else
+#define AUGMENTATION_KERNEL
+#endif
+
+namespace program
+{
+    namespace cpu_dispatch
+    {
+        /**
+         * @brief Name of the ISA level the kernels run with on this host.
+         */
+        inline const char* selected_level()
+        {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__linux__) && !defined(AUGMENTATION_NO_DISPATCH)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+                return "avx512f";
+            if (__builtin_cpu_supports("avx2"))
+                return "avx2";
+            if (__builtin_cpu_supports("sse4.2"))
+                return "sse4.2";
+
+            return "baseline";
+#else
+            return "baseline (dispatch disabled)";
+#endif
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#include "augmentation/cross_asset.hpp"
+#include "augmentation/cpu_dispatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace program
+{
+    reference_series::reference_series(std::string name, std::vector<uint64_t> timestamps, const std::vector<double>& close) :
+        m_name(std::move(name)), m_timestamps(std::move(timestamps)), m_log_returns(close.size())
+    {
+        if (!close.empty())
+            m_log_returns[0] = std::numeric_limits<double>::quiet_NaN();
+
+        for (size_t i = 1; i < close.size(); i++)
+            m_log_returns[i] = std::log(close[i] / close[i - 1]);
+    }
+
+    AUGMENTATION_KERNEL void cross_asset_features::compute(const uint64_t* timestamps, const double* close, size_t row_count, const reference_series& reference,
+        const std::vector<size_t>& windows, double* out)
+    {
+        constexpr double missing = std::numeric_limits<double>::quiet_NaN();
+
+        // pair every row with the reference return at the same timestamp, pairs with a missing side don't count
+        std::vector<double> x(row_count), y(row_count);
+        std::vector<uint8_t> valid(row_count);
+
+        size_t reference_row = 0;
+        for (size_t i = 0; i < row_count; i++)
+        {
+            while (reference_row < reference.m_timestamps.size() && reference.m_timestamps[reference_row] < timestamps[i])
+                reference_row++;
+
+            const double symbol_return = i ? std::log(close[i] / close[i - 1]) : missing;
+            const double reference_return = reference_row < reference.m_timestamps.size() && reference.m_timestamps[reference_row] == timestamps[i]
+                ? reference.m_log_returns[reference_row] : missing;
+
+            valid[i] = std::isfinite(symbol_return) && std::isfinite(reference_return);
+            x[i] = valid[i] ? symbol_return : 0.0;
+            y[i] = valid[i] ? reference_return : 0.0;
+        }
+
+        // window sums, one entry per window
+        const size_t window_count = windows.size();
+        std::vector<double> sum_x(window_count), sum_y(window_count), sum_xx(window_count), sum_yy(window_count), sum_xy(window_count);
+        std::vector<size_t> count(window_count);
+
+        for (size_t i = 0; i < row_count; i++)
+        {
+            const double xi = x[i], yi = y[i];
+            const size_t vi = valid[i];
+
+            for (size_t w = 0; w < window_count; w++)
+            {
+                const size_t window = windows[w];
+                sum_x[w] += xi;
+                sum_y[w] += yi;
+                sum_xx[w] += xi * xi;
+                sum_yy[w] += yi * yi;
+                sum_xy[w] += xi * yi;
+                count[w] += vi;
+
+                // invalid rows hold zeros, removing them is a no-op
+                if (i >= window)
+                {
+                    const size_t r = i - window;
+                    sum_x[w] -= x[r];
+                    sum_y[w] -= y[r];
+                    sum_xx[w] -= x[r] * x[r];
+                    sum_yy[w] -= y[r] * y[r];
+                    sum_xy[w] -= x[r] * y[r];
+                    count[w] -= valid[r];
+                }
+
+                double* correlation = out + (w * feature_count + 0) * row_count;
+                double* beta = out + (w * feature_count + 1) * row_count;
+                double* relative_strength = out + (w * feature_count + 2) * row_count;
+
+                const double n = (double)count[w];
+                const double covariance = n * sum_xy[w] - sum_x[w] * sum_y[w];
+                const double variance_x = n * sum_xx[w] - sum_x[w] * sum_x[w];
+                const double variance_y = n * sum_yy[w] - sum_y[w] * sum_y[w];
+
+                // the first row has no return, so a window is complete once it reaches past it
+                const bool complete = i >= window && count[w] >= 2;
+                correlation[i] = complete && variance_x > 0.0 && variance_y > 0.0 ? covariance / std::sqrt(variance_x * variance_y) : missing;
+                beta[i] = complete && variance_y > 0.0 ? covariance / variance_y : missing;
+                relative_strength[i] = complete ? sum_x[w] - sum_y[w] : missing;
+            }
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace program
+{
+    /**
+     * @brief Close prices of a reference symbol, loaded once and shared read only by every worker.
+     */
+    struct reference_series
+    {
+        std::string m_name;
+        std::vector<uint64_t> m_timestamps;
+        // log return of every row against the previous one, NaN for the first row
+        std::vector<double> m_log_returns;
+
+        reference_series(std::string name, std::vector<uint64_t> timestamps, const std::vector<double>& close);
+    };
+
+    // Cross asset file written next to every output (<stem>.cross). The header is followed by window_count uint64
+    // windows and then by one column of row_count doubles per reference, window and feature, in that nesting order.
+    // The features are correlation, beta and relative strength, see cross_asset_features.
+    struct cross_asset_header
+    {
+        char m_magic[8];
+        uint32_t m_reference_count;
+        uint32_t m_window_count;
+        uint64_t m_row_count;
+
+        static constexpr char magic[8] = { 'A', 'U', 'G', 'X', 'A', 'S', '1', '\0' };
+    };
+    static_assert(sizeof(cross_asset_header) == 24, "cross_asset_header is part of the file format");
+
+    /**
+     * @brief Rolling statistics of a symbol's log returns x against a reference's log returns y at the same timestamps:
+     * correlation, beta (cov(x, y) / var(y)) and relative strength (sum of x - sum of y, the log outperformance).
+     * The window sums are updated in O(1) per row, the loops over the windows share every row's data.
+     * Rows whose window isn't complete yet, or that lack the spread for a statistic, are NaN.
+     */
+    class cross_asset_features final
+    {
+    public:
+        static constexpr size_t feature_count = 3;
+
+        /**
+         * @param out feature_count * windows.size() columns of row_count doubles, ordered by window and then feature
+         */
+        static void compute(const uint64_t* timestamps, const double* close, size_t row_count, const reference_series& reference,
+            const std::vector<size_t>& windows, double* out);
+    };
+}
@@ -0,0 +1,167 @@
+#include "augmentation/indicators.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <ta-lib/ta_libc.h>
+
+namespace program
+{
+    // TA-Lib writes its first value to index 0 of the output, which belongs to row begin_index
+    static void align_column(double* column, size_t row_count, int begin_index, int element_count)
+    {
+        memmove(column + begin_index, column, element_count * sizeof(double));
+        std::fill(column, column + begin_index, 0.0);
+        std::fill(column + begin_index + element_count, column + row_count, 0.0);
+    }
+
+    // TA-Lib functions with several outputs need all of them, unrequested ones go to scratch memory
+    static double* column_or_scratch(double* column, std::vector<double>& scratch, size_t row_count)
+    {
+        if (column)
+            return column;
+
+        scratch.resize(row_count);
+
+        return scratch.data();
+    }
+
+    compute_status compute_indicators(const input_columns& input, const output_columns& output, const indicator_config& config)
+    {
+        if (!input.m_high || !input.m_low || !input.m_close || !input.m_volume || input.m_row_count > (size_t)INT_MAX)
+            return compute_status::invalid_input;
+        if (!input.m_row_count)
+            return compute_status::success;
+
+        static std::once_flag ta_initialized;
+        std::call_once(ta_initialized, []() { TA_Initialize(); });
+
+        const size_t rows = input.m_row_count;
+        const int end_index = (int)rows - 1;
+        int begin_index = 0, element_count = 0;
+
+        if (output.m_adosc)
+        {
+            if (TA_ADOSC(0, end_index, input.m_high, input.m_low, input.m_close, input.m_volume, (int)config.m_adosc_fast_period, (int)config.m_adosc_slow_period, &begin_index, &element_count, output.m_adosc) != TA_SUCCESS)
+                return compute_status::ta_lib_error;
+
+            align_column(output.m_adosc, rows, begin_index, element_count);
+        }
+
+        if (output.m_atr)
+        {
+            if (TA_ATR(0, end_index, input.m_high, input.m_low, input.m_close, (int)config.m_atr_period, &begin_index, &element_count, output.m_atr) != TA_SUCCESS)
+                return compute_status::ta_lib_error;
+
+            align_column(output.m_atr, rows, begin_index, element_count);
+        }
+
+        if (output.m_upper_band || output.m_middle_band || output.m_lower_band)
+        {
+            std::vector<double> scratch_upper, scratch_middle, scratch_lower;
+            double* upper = column_or_scratch(output.m_upper_band, scratch_upper, rows);
+            double* middle = column_or_scratch(output.m_middle_band, scratch_middle, rows);
+            double* lower = column_or_scratch(output.m_lower_band, scratch_lower, rows);
+
+            if (TA_BBANDS(0, end_index, input.m_close, (int)config.m_bbands_period, (double)config.m_bbands_deviation_up, (double)config.m_bbands_deviation_down, TA_MAType_SMA, &begin_index, &element_count, upper, middle, lower) != TA_SUCCESS)
+                return compute_status::ta_lib_error;
+
+            align_column(upper, rows, begin_index, element_count);
+            align_column(middle, rows, begin_index, element_count);
+            align_column(lower, rows, begin_index, element_count);
+        }
+
+        if (output.m_macd || output.m_macd_signal || output.m_macd_hist)
+        {
+            std::vector<double> scratch_macd, scratch_signal, scratch_hist;
+            double* macd = column_or_scratch(output.m_macd, scratch_macd, rows);
+            double* signal = column_or_scratch(output.m_macd_signal, scratch_signal, rows);
+            double* hist = column_or_scratch(output.m_macd_hist, scratch_hist, rows);
+
+            if (TA_MACD(0, end_index, input.m_close, (int)config.m_macd_fast_period, (int)config.m_macd_slow_period, (int)config.m_macd_signal_period, &begin_index, &element_count, macd, signal, hist) != TA_SUCCESS)
+                return compute_status::ta_lib_error;
+
+            align_column(macd, rows, begin_index, element_count);
+            align_column(signal, rows, begin_index, element_count);
+            align_column(hist, rows, begin_index, element_count);
+        }
+
+        if (output.m_mfi)
+        {
+            if (TA_MFI(0, end_index, input.m_high, input.m_low, input.m_close, input.m_volume, (int)config.m_mfi_period, &begin_index, &element_count, output.m_mfi) != TA_SUCCESS)
+                return compute_status::ta_lib_error;
+
+            align_column(output.m_mfi, rows, begin_index, element_count);
+        }
+
+        if (output.m_rsi)
+        {
+            if (TA_RSI(0, end_index, input.m_close, (int)config.m_rsi_period, &begin_index, &element_count, output.m_rsi) != TA_SUCCESS)
+                return compute_status::ta_lib_error;
+
+            align_column(output.m_rsi, rows, begin_index, element_count);
+        }
+
+        return compute_status::success;
+    }
+
+    void compute_indicators(indicator_job* jobs, size_t job_count, const indicator_config& config, size_t thread_count)
+    {
+        if (!thread_count)
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        thread_count = std::min(thread_count, job_count);
+
+        std::atomic<size_t> next_job{ 0 };
+        const auto work = [&]()
+        {
+            for (size_t i; (i = next_job.fetch_add(1, std::memory_order_relaxed)) < job_count;)
+                jobs[i].m_status = compute_indicators(jobs[i].m_input, jobs[i].m_output, config);
+        };
+
+        // the calling thread is one of the workers
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < thread_count; i++)
+            workers.emplace_back(work);
+        work();
+
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    size_t indicator_lookback(const indicator_config& config)
+    {
+        const int lookbacks[] =
+        {
+            TA_ADOSC_Lookback((int)config.m_adosc_fast_period, (int)config.m_adosc_slow_period),
+            TA_ATR_Lookback((int)config.m_atr_period),
+            TA_BBANDS_Lookback((int)config.m_bbands_period, (double)config.m_bbands_deviation_up, (double)config.m_bbands_deviation_down, TA_MAType_SMA),
+            TA_MACD_Lookback((int)config.m_macd_fast_period, (int)config.m_macd_slow_period, (int)config.m_macd_signal_period),
+            TA_MFI_Lookback((int)config.m_mfi_period),
+            TA_RSI_Lookback((int)config.m_rsi_period)
+        };
+
+        // TA-Lib reports -1 for invalid periods
+        return (size_t)std::max(0, *std::max_element(std::begin(lookbacks), std::end(lookbacks)));
+    }
+
+    const char* to_string(compute_status status)
+    {
+        switch (status)
+        {
+        case compute_status::success:
+            return "success";
+        case compute_status::invalid_input:
+            return "invalid input";
+        case compute_status::ta_lib_error:
+            return "TA-Lib error";
+        }
+
+        return "unknown";
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+
+// In-memory indicator pipeline, built as the AugmentationLib target.
+// Everything in here works on caller owned buffers: no file I/O, no logging and no global thread pool.
+
+namespace program
+{
+    // periods and deviations used by the indicator calculations
+    struct indicator_config
+    {
+        size_t m_adosc_fast_period = 24;
+        size_t m_adosc_slow_period = 45;
+        size_t m_atr_period = 24;
+        size_t m_bbands_period = 20;
+        size_t m_bbands_deviation_up = 2;
+        size_t m_bbands_deviation_down = 2;
+        size_t m_macd_fast_period = 12;
+        size_t m_macd_slow_period = 26;
+        size_t m_macd_signal_period = 9;
+        size_t m_mfi_period = 30;
+        size_t m_rsi_period = 14;
+    };
+
+    // caller owned input columns, each of them holds m_row_count values
+    struct input_columns
+    {
+        const double* m_high = nullptr;
+        const double* m_low = nullptr;
+        const double* m_close = nullptr;
+        const double* m_volume = nullptr;
+        size_t m_row_count = 0;
+    };
+
+    // caller owned output columns with room for m_row_count values each, nullptr columns are not computed.
+    // Row i always belongs to input row i, rows inside the lookback period of an indicator are set to 0.
+    struct output_columns
+    {
+        double* m_adosc = nullptr;
+
+        double* m_atr = nullptr;
+
+        double* m_macd = nullptr;
+        double* m_macd_signal = nullptr;
+        double* m_macd_hist = nullptr;
+
+        double* m_mfi = nullptr;
+
+        double* m_upper_band = nullptr;
+        double* m_middle_band = nullptr;
+        double* m_lower_band = nullptr;
+
+        double* m_rsi = nullptr;
+    };
+
+    enum class compute_status
+    {
+        success,
+        // a required input column is missing or the row count doesn't fit into TA-Lib's int indices
+        invalid_input,
+        // TA-Lib rejected the call, usually because of an invalid period
+        ta_lib_error
+    };
+
+    // one symbol of a batch, m_status is set once the batch returns
+    struct indicator_job
+    {
+        input_columns m_input;
+        output_columns m_output;
+        compute_status m_status = compute_status::success;
+    };
+
+    /**
+     * @brief Computes every requested indicator column. Thread safe, TA-Lib is initialized on first use.
+     */
+    compute_status compute_indicators(const input_columns& input, const output_columns& output, const indicator_config& config = {});
+
+    /**
+     * @brief Computes many symbols in parallel, every worker takes the next job until all are done.
+     * @param thread_count number of workers, 0 uses one per hardware thread
+     */
+    void compute_indicators(indicator_job* jobs, size_t job_count, const indicator_config& config = {}, size_t thread_count = 0);
+
+    /**
+     * @brief Number of leading rows in which at least one indicator is still in its lookback period.
+     */
+    size_t indicator_lookback(const indicator_config& config = {});
+
+    const char* to_string(compute_status status);
+}
@@ -0,0 +1,102 @@
+#include "augmentation/labels.hpp"
+#include "augmentation/cpu_dispatch.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace program
+{
+    /**
+     * @brief Sparse table of range extrema, level l holds the extremum of the 2^l values starting at each row.
+     * Only the levels up to the horizon are built, no search ever skips more than that.
+     */
+    template <typename Compare>
+    class sparse_table final
+    {
+        std::vector<std::vector<double>> m_levels;
+
+    public:
+        sparse_table(const double* values, size_t row_count, size_t max_span)
+        {
+            m_levels.emplace_back(values, values + row_count);
+
+            for (size_t span = 2; span <= max_span && span <= row_count; span *= 2)
+            {
+                const std::vector<double>& previous = m_levels.back();
+                std::vector<double> level(row_count - span + 1);
+
+                const size_t half = span / 2;
+                for (size_t i = 0; i < level.size(); i++)
+                    level[i] = Compare{}(previous[i], previous[i + half]) ? previous[i] : previous[i + half];
+
+                m_levels.push_back(std::move(level));
+            }
+        }
+
+        /**
+         * @brief First row in [begin, end] whose value reaches target in the direction of Compare, or end + 1.
+         */
+        template <typename Reaches>
+        size_t first_hit(size_t begin, size_t end, Reaches reaches) const
+        {
+            size_t row = begin;
+
+            // skip the largest blocks that can't contain a hit, what remains starts at the first hit
+            for (size_t level = m_levels.size(); level-- > 0;)
+            {
+                const size_t span = (size_t)1 << level;
+                if (row + span - 1 <= end && !reaches(m_levels[level][row]))
+                    row += span;
+            }
+
+            return row <= end && reaches(m_levels[0][row]) ? row : end + 1;
+        }
+    };
+
+    AUGMENTATION_KERNEL void forward_returns(const double* close, size_t row_count, size_t horizon, double* out)
+    {
+        const size_t labeled = row_count > horizon ? row_count - horizon : 0;
+
+        for (size_t i = 0; i < labeled; i++)
+            out[i] = close[i + horizon] / close[i] - 1.0;
+
+        std::fill(out + labeled, out + row_count, std::numeric_limits<double>::quiet_NaN());
+    }
+
+    void barrier_labels(const double* close, size_t row_count, const label_config& config, int8_t* labels, uint32_t* offsets)
+    {
+        std::fill(labels, labels + row_count, 0);
+        std::fill(offsets, offsets + row_count, 0);
+
+        const size_t horizon = config.m_horizon;
+        if (!horizon || row_count <= horizon)
+            return;
+
+        const sparse_table<std::greater<double>> maxima(close, row_count, horizon);
+        const sparse_table<std::less<double>> minima(close, row_count, horizon);
+
+        for (size_t i = 0; i + horizon < row_count; i++)
+        {
+            const double upper = close[i] * (1.0 + config.m_upper_barrier);
+            const double lower = close[i] * (1.0 - config.m_lower_barrier);
+            const size_t end = i + horizon;
+
+            const size_t upper_hit = maxima.first_hit(i + 1, end, [upper](double value) { return value >= upper; });
+            const size_t lower_hit = minima.first_hit(i + 1, end, [lower](double value) { return value <= lower; });
+
+            // both barriers can only be hit by the same close when they overlap, the upper one wins then
+            if (upper_hit <= end && upper_hit <= lower_hit)
+            {
+                labels[i] = 1;
+                offsets[i] = (uint32_t)(upper_hit - i);
+            }
+            else if (lower_hit <= end)
+            {
+                labels[i] = -1;
+                offsets[i] = (uint32_t)(lower_hit - i);
+            }
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace program
+{
+    // look-ahead training targets computed from the close prices of a symbol
+    struct label_config
+    {
+        // candles to look ahead, 0 disables labels
+        size_t m_horizon = 0;
+        // relative distance of the take profit and stop loss barriers from the entry close, 0 disables barrier labels
+        double m_upper_barrier = 0.0;
+        double m_lower_barrier = 0.0;
+
+        bool has_barriers() const
+        {
+            return m_upper_barrier > 0.0 && m_lower_barrier > 0.0;
+        }
+    };
+
+    // Label file written next to every output (<stem>.labels) when labels are enabled. The header is followed by
+    // row_count doubles of forward returns and, with barriers, row_count uint32 hit offsets and row_count int8 labels.
+    struct label_file_header
+    {
+        char m_magic[8];
+        uint32_t m_horizon;
+        uint32_t m_has_barriers;
+        double m_upper_barrier;
+        double m_lower_barrier;
+        uint64_t m_row_count;
+
+        static constexpr char magic[8] = { 'A', 'U', 'G', 'L', 'B', 'L', '1', '\0' };
+    };
+    static_assert(sizeof(label_file_header) == 40, "label_file_header is part of the file format");
+
+    /**
+     * @brief out[i] = close[i + horizon] / close[i] - 1, NaN for the last horizon rows.
+     */
+    void forward_returns(const double* close, size_t row_count, size_t horizon, double* out);
+
+    /**
+     * @brief Triple barrier labels: +1 when close reaches close[i] * (1 + upper) first, -1 when it reaches
+     * close[i] * (1 - lower) first and 0 when neither happens within the horizon. offsets[i] is the number of
+     * candles until the first hit, or 0 when no barrier was hit. Rows without a full horizon get label 0.
+     * First hits are found with a sparse table over window maxima and minima, O(log horizon) per row.
+     */
+    void barrier_labels(const double* close, size_t row_count, const label_config& config, int8_t* labels, uint32_t* offsets);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace program
+{
+    /**
+     * @brief Read only mapping of a whole file, empty when the file couldn't be mapped or has no content.
+     */
+    class mapped_file final
+    {
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+
+    public:
+        mapped_file() = default;
+
+        /**
+         * @param advice madvise hint for the expected access pattern
+         */
+        explicit mapped_file(const std::filesystem::path& file, int advice = MADV_NORMAL)
+        {
+            const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return;
+
+            struct stat info;
+            if (fstat(fd, &info) == 0 && info.st_size > 0)
+            {
+                void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED)
+                {
+                    madvise(data, info.st_size, advice);
+
+                    m_data = (const uint8_t*)data;
+                    m_size = info.st_size;
+                }
+            }
+            close(fd);
+        }
+
+        mapped_file(mapped_file&& other) noexcept :
+            m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0))
+        {
+
+        }
+
+        mapped_file& operator=(mapped_file&& other) noexcept
+        {
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+
+            return *this;
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        ~mapped_file()
+        {
+            if (m_data)
+                munmap((void*)m_data, m_size);
+        }
+
+        const uint8_t* data() const
+        {
+            return m_data;
+        }
+
+        size_t size() const
+        {
+            return m_size;
+        }
+    };
+}
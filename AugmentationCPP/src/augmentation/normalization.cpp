@@ -0,0 +1,132 @@
+#include "augmentation/normalization.hpp"
+#include "augmentation/cpu_dispatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace program
+{
+    rolling_normalizer::rolling_normalizer(normalization_mode mode, size_t window, size_t column_count) :
+        m_mode(mode), m_window(std::max<size_t>(window, 1)), m_column_count(column_count),
+        m_history(m_window * column_count)
+    {
+        if (mode == normalization_mode::zscore)
+        {
+            m_mean.resize(column_count);
+            m_m2.resize(column_count);
+        }
+        else if (mode == normalization_mode::minmax)
+        {
+            m_min_rows.resize(m_window * column_count);
+            m_max_rows.resize(m_window * column_count);
+            m_min_head.resize(column_count);
+            m_min_size.resize(column_count);
+            m_max_head.resize(column_count);
+            m_max_size.resize(column_count);
+        }
+    }
+
+    void rolling_normalizer::update(double* row)
+    {
+        if (m_mode == normalization_mode::zscore)
+        {
+            // the slot of the row that leaves the window, overwritten with the new raw values
+            double* slot = &m_history[(m_row_count % m_window) * m_column_count];
+            this->update_zscore(row, slot);
+        }
+        else if (m_mode == normalization_mode::minmax)
+        {
+            this->update_minmax(row);
+        }
+
+        m_row_count++;
+    }
+
+    void rolling_normalizer::update(double* rows, size_t row_count, size_t stride)
+    {
+        for (size_t i = 0; i < row_count; i++)
+            this->update(rows + i * stride);
+    }
+
+    AUGMENTATION_KERNEL void rolling_normalizer::update_zscore(double* row, double* slot)
+    {
+        double* mean = m_mean.data();
+        double* m2 = m_m2.data();
+
+        if (m_row_count < m_window)
+        {
+            // growing window, plain Welford step
+            const double n = (double)(m_row_count + 1);
+            for (size_t c = 0; c < m_column_count; c++)
+            {
+                const double x = row[c];
+                const double delta = x - mean[c];
+                mean[c] += delta / n;
+                m2[c] += delta * (x - mean[c]);
+                slot[c] = x;
+            }
+        }
+        else
+        {
+            // full window, the oldest value is replaced by the new one in a single step
+            const double n = (double)m_window;
+            for (size_t c = 0; c < m_column_count; c++)
+            {
+                const double x = row[c];
+                const double removed = slot[c];
+                const double old_mean = mean[c];
+                mean[c] += (x - removed) / n;
+                m2[c] += (x - removed) * (x - mean[c] + removed - old_mean);
+                slot[c] = x;
+            }
+        }
+
+        const double n = (double)std::min(m_row_count + 1, m_window);
+        for (size_t c = 0; c < m_column_count; c++)
+        {
+            // rounding can leave a tiny negative sum of squares behind
+            const double variance = std::max(m2[c], 0.0) / n;
+            const double deviation = std::sqrt(variance);
+            row[c] = deviation > 1e-12 ? (row[c] - mean[c]) / deviation : 0.0;
+        }
+    }
+
+    void rolling_normalizer::update_minmax(double* row)
+    {
+        const size_t index = m_row_count;
+        std::copy(row, row + m_column_count, &m_history[(index % m_window) * m_column_count]);
+
+        for (size_t c = 0; c < m_column_count; c++)
+        {
+            size_t* min_rows = &m_min_rows[c * m_window];
+            size_t* max_rows = &m_max_rows[c * m_window];
+            size_t& min_head = m_min_head[c], & min_size = m_min_size[c];
+            size_t& max_head = m_max_head[c], & max_size = m_max_size[c];
+            const double x = row[c];
+
+            // drop the row that left the window before comparing, its history slot now holds the new row
+            if (min_size && min_rows[min_head] + m_window <= index)
+            {
+                min_head = (min_head + 1) % m_window;
+                min_size--;
+            }
+            if (max_size && max_rows[max_head] + m_window <= index)
+            {
+                max_head = (max_head + 1) % m_window;
+                max_size--;
+            }
+
+            while (min_size && this->value(min_rows[(min_head + min_size - 1) % m_window], c) >= x)
+                min_size--;
+            min_rows[(min_head + min_size++) % m_window] = index;
+
+            while (max_size && this->value(max_rows[(max_head + max_size - 1) % m_window], c) <= x)
+                max_size--;
+            max_rows[(max_head + max_size++) % m_window] = index;
+
+            const double min = this->value(min_rows[min_head], c);
+            const double range = this->value(max_rows[max_head], c) - min;
+            row[c] = range > 1e-12 ? (x - min) / range : 0.0;
+        }
+    }
+}
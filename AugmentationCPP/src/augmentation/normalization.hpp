@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace program
+{
+    enum class normalization_mode
+    {
+        none,
+        // (value - rolling mean) / rolling standard deviation
+        zscore,
+        // (value - rolling min) / (rolling max - rolling min), in [0, 1]
+        minmax
+    };
+
+    /**
+     * @brief Normalizes rows of column_count values against the last window rows of each column.
+     * Every update is O(1) per column: mean and variance follow a sliding Welford update, min and max
+     * come from monotonic deques. Until window rows were seen the statistics cover all rows so far,
+     * columns without spread in the window normalize to 0.
+     */
+    class rolling_normalizer final
+    {
+        normalization_mode m_mode;
+        size_t m_window;
+        size_t m_column_count;
+
+        // raw values of the last m_window rows, row i lives at (i % m_window) * m_column_count
+        std::vector<double> m_history;
+        size_t m_row_count = 0;
+
+        // zscore state, one entry per column so the update loops vectorize across columns
+        std::vector<double> m_mean;
+        std::vector<double> m_m2;
+
+        // minmax state, per column a ring of row indices with increasing (min) or decreasing (max) values
+        std::vector<size_t> m_min_rows;
+        std::vector<size_t> m_max_rows;
+        std::vector<size_t> m_min_head, m_min_size;
+        std::vector<size_t> m_max_head, m_max_size;
+
+    public:
+        rolling_normalizer(normalization_mode mode, size_t window, size_t column_count);
+
+        /**
+         * @brief Normalizes one row in place, rows have to be passed in time order.
+         */
+        void update(double* row);
+
+        /**
+         * @brief Normalizes row_count rows that are stride doubles apart.
+         */
+        void update(double* rows, size_t row_count, size_t stride);
+
+    private:
+        double value(size_t row, size_t column) const
+        {
+            return m_history[(row % m_window) * m_column_count + column];
+        }
+
+        void update_zscore(double* row, double* slot);
+        void update_minmax(double* row);
+    };
+}
@@ -0,0 +1,236 @@
+#include "augmentation/panel_builder.hpp"
+#include "augmentation/mapped_file.hpp"
+#include "augmentation/row_format.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace program
+{
+    // runs work(i) for every i < count, the calling thread is one of the workers
+    template <typename Work>
+    static void parallel_for(size_t count, size_t thread_count, Work&& work)
+    {
+        std::atomic<size_t> next{ 0 };
+        const auto run = [&]()
+        {
+            for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+                work(i);
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < std::min(thread_count, count); i++)
+            workers.emplace_back(run);
+        run();
+
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    bool panel_builder::build(const std::vector<std::filesystem::path>& inputs, uint32_t format, panel_layout layout, const std::filesystem::path& output, size_t thread_count)
+    {
+        if (!thread_count)
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        if (format >= row_format::format_count)
+        {
+            m_error = "unknown row format";
+
+            return false;
+        }
+
+        const size_t row_size = row_format::row_sizes[format];
+        const size_t symbol_count = inputs.size();
+
+        std::vector<mapped_file> files(symbol_count);
+        std::vector<std::vector<uint64_t>> timestamps(symbol_count);
+        std::vector<std::string> errors(symbol_count);
+
+        parallel_for(symbol_count, thread_count, [&](size_t s)
+        {
+            files[s] = mapped_file(inputs[s], MADV_SEQUENTIAL);
+            if (files[s].size() % row_size)
+            {
+                errors[s] = inputs[s].filename().string() + " doesn't match the row format";
+
+                return;
+            }
+
+            const size_t row_count = files[s].size() / row_size;
+            std::vector<uint64_t>& column = timestamps[s];
+            column.resize(row_count);
+            for (size_t i = 0; i < row_count; i++)
+                column[i] = row_format::timestamp(files[s].data() + i * row_size);
+
+            // the merge and the fill both rely on a strictly increasing index per symbol
+            if (std::adjacent_find(column.begin(), column.end(), std::greater_equal<uint64_t>()) != column.end())
+                errors[s] = inputs[s].filename().string() + " has duplicated or unordered timestamps, process it with --gaps";
+        });
+
+        for (const std::string& error : errors)
+            if (!error.empty())
+            {
+                m_error = error;
+
+                return false;
+            }
+
+        const std::vector<uint64_t> index = merge_timestamps(timestamps, thread_count);
+        const size_t timestamp_count = index.size();
+        constexpr size_t value_count = row_format::value_count;
+
+        const size_t values_offset = sizeof(panel_header) + timestamp_count * sizeof(uint64_t);
+        const size_t file_size = values_offset + symbol_count * timestamp_count * value_count * sizeof(double);
+
+        const int fd = ::open(output.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0 || ftruncate(fd, file_size) != 0)
+        {
+            m_error = "failed to create " + output.string() + ": " + strerror(errno);
+            if (fd >= 0)
+                close(fd);
+
+            return false;
+        }
+
+        void* mapping = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            m_error = "failed to map " + output.string() + ": " + strerror(errno);
+
+            return false;
+        }
+
+        uint8_t* data = (uint8_t*)mapping;
+
+        panel_header header{};
+        memcpy(header.m_magic, panel_header::magic, sizeof(header.m_magic));
+        header.m_layout = (uint32_t)layout;
+        header.m_value_count = value_count;
+        header.m_symbol_count = symbol_count;
+        header.m_timestamp_count = timestamp_count;
+        memcpy(data, &header, sizeof(header));
+        memcpy(data + sizeof(header), index.data(), timestamp_count * sizeof(uint64_t));
+
+        double* values = (double*)(data + values_offset);
+        constexpr double missing = std::numeric_limits<double>::quiet_NaN();
+
+        // fills the rows of symbol s for the index range [begin, end) at out, stride doubles apart
+        const auto fill = [&](size_t s, size_t begin, size_t end, double* out, size_t stride)
+        {
+            const std::vector<uint64_t>& column = timestamps[s];
+            size_t row = std::lower_bound(column.begin(), column.end(), index[begin]) - column.begin();
+
+            for (size_t t = begin; t < end; t++, out += stride)
+            {
+                if (row < column.size() && column[row] == index[t])
+                    row_format::decode(files[s].data() + row++ * row_size, format, out);
+                else
+                    std::fill(out, out + value_count, missing);
+            }
+        };
+
+        if (timestamp_count)
+        {
+            if (layout == panel_layout::symbol_major)
+            {
+                // every worker writes complete series
+                parallel_for(symbol_count, thread_count, [&](size_t s)
+                {
+                    fill(s, 0, timestamp_count, values + s * timestamp_count * value_count, value_count);
+                });
+            }
+            else
+            {
+                // every worker writes complete cross sections of a block of timestamps
+                constexpr size_t block_size = 4096;
+                const size_t block_count = (timestamp_count + block_size - 1) / block_size;
+                const size_t row_stride = symbol_count * value_count;
+
+                parallel_for(block_count, thread_count, [&](size_t block)
+                {
+                    const size_t begin = block * block_size;
+                    const size_t end = std::min(begin + block_size, timestamp_count);
+
+                    for (size_t s = 0; s < symbol_count; s++)
+                        fill(s, begin, end, values + begin * row_stride + s * value_count, row_stride);
+                });
+            }
+        }
+
+        const bool synced = msync(mapping, file_size, MS_SYNC) == 0;
+        munmap(mapping, file_size);
+        if (!synced)
+        {
+            m_error = "failed to write " + output.string() + ": " + strerror(errno);
+
+            return false;
+        }
+
+        return true;
+    }
+
+    std::vector<uint64_t> panel_builder::merge_timestamps(const std::vector<std::vector<uint64_t>>& timestamps, size_t thread_count)
+    {
+        // split the timestamp range at quantiles of a sample so every part merges a similar number of rows
+        std::vector<uint64_t> sample;
+        for (const std::vector<uint64_t>& column : timestamps)
+            for (size_t i = 0; i < 64 && !column.empty(); i++)
+                sample.push_back(column[i * column.size() / 64]);
+        std::sort(sample.begin(), sample.end());
+
+        std::vector<uint64_t> splitters;
+        for (size_t p = 1; p < thread_count && !sample.empty(); p++)
+            splitters.push_back(sample[p * sample.size() / thread_count]);
+        splitters.erase(std::unique(splitters.begin(), splitters.end()), splitters.end());
+
+        // part p covers [splitters[p - 1], splitters[p]), the first and last part are open ended
+        const size_t part_count = splitters.size() + 1;
+        std::vector<std::vector<uint64_t>> parts(part_count);
+
+        parallel_for(part_count, thread_count, [&](size_t p)
+        {
+            using cursor = std::pair<uint64_t, size_t>;
+            std::priority_queue<cursor, std::vector<cursor>, std::greater<cursor>> heap;
+            std::vector<size_t> positions(timestamps.size()), ends(timestamps.size());
+
+            for (size_t s = 0; s < timestamps.size(); s++)
+            {
+                const std::vector<uint64_t>& column = timestamps[s];
+                positions[s] = p ? std::lower_bound(column.begin(), column.end(), splitters[p - 1]) - column.begin() : 0;
+                ends[s] = p < splitters.size() ? std::lower_bound(column.begin(), column.end(), splitters[p]) - column.begin() : column.size();
+
+                if (positions[s] < ends[s])
+                    heap.emplace(column[positions[s]], s);
+            }
+
+            std::vector<uint64_t>& merged = parts[p];
+            while (!heap.empty())
+            {
+                const auto [timestamp, s] = heap.top();
+                heap.pop();
+
+                if (merged.empty() || merged.back() != timestamp)
+                    merged.push_back(timestamp);
+
+                if (++positions[s] < ends[s])
+                    heap.emplace(timestamps[s][positions[s]], s);
+            }
+        });
+
+        std::vector<uint64_t> index;
+        for (const std::vector<uint64_t>& part : parts)
+            index.insert(index.end(), part.begin(), part.end());
+
+        return index;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace program
+{
+    enum class panel_layout
+    {
+        // [timestamp][symbol][value], one cross section after the other
+        time_major,
+        // [symbol][timestamp][value], one complete series after the other
+        symbol_major
+    };
+
+    // The header is followed by timestamp_count uint64 timestamps of the shared index and the values as doubles.
+    // Symbols without a candle at a timestamp have NaN values there.
+    struct panel_header
+    {
+        char m_magic[8];
+        uint32_t m_layout;
+        uint32_t m_value_count;
+        uint64_t m_symbol_count;
+        uint64_t m_timestamp_count;
+
+        static constexpr char magic[8] = { 'A', 'U', 'G', 'P', 'N', 'L', '1', '\0' };
+    };
+    static_assert(sizeof(panel_header) == 32, "panel_header is part of the file format");
+
+    /**
+     * @brief Aligns the .bin outputs of many symbols on the union of their timestamps.
+     * The shared index comes from a k-way merge that is split into timestamp ranges merged in parallel,
+     * the panel is then filled in place through a mapping of the output file.
+     */
+    class panel_builder final
+    {
+        std::string m_error;
+
+    public:
+        /**
+         * @param inputs .bin outputs in the order their symbols should appear in the panel
+         * @param format row format of the inputs, the integer value of output_precision
+         * @param thread_count 0 uses one thread per hardware thread
+         */
+        bool build(const std::vector<std::filesystem::path>& inputs, uint32_t format, panel_layout layout, const std::filesystem::path& output, size_t thread_count = 0);
+
+        const std::string& error() const
+        {
+            return m_error;
+        }
+
+    private:
+        static std::vector<uint64_t> merge_timestamps(const std::vector<std::vector<uint64_t>>& timestamps, size_t thread_count);
+    };
+}
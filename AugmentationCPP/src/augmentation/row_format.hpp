@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace program
+{
+    // Row formats of the .bin outputs, indexed by the integer value of output_precision:
+    // a uint64 timestamp followed by 15 doubles (f64), 15 floats (f32) or 5 floats and 10 bfloat16 (bf16).
+    namespace row_format
+    {
+        static constexpr size_t value_count = 15;
+        static constexpr size_t price_count = 5;
+        static constexpr size_t format_count = 3;
+        static constexpr size_t row_sizes[format_count] = { 8 + 15 * 8, 8 + 15 * 4, 8 + 5 * 4 + 10 * 2 };
+
+        inline uint64_t timestamp(const uint8_t* row)
+        {
+            uint64_t value;
+            memcpy(&value, row, sizeof(value));
+
+            return value;
+        }
+
+        inline float from_bfloat16(uint16_t value)
+        {
+            const uint32_t bits = (uint32_t)value << 16;
+
+            float result;
+            memcpy(&result, &bits, sizeof(result));
+
+            return result;
+        }
+
+        /**
+         * @brief Decodes the value_count values of a row into out.
+         */
+        template <typename T>
+        void decode(const uint8_t* row, uint32_t format, T* out)
+        {
+            const uint8_t* values = row + sizeof(uint64_t);
+
+            switch (format)
+            {
+            case 0:
+            {
+                double buffer[value_count];
+                memcpy(buffer, values, sizeof(buffer));
+                for (size_t i = 0; i < value_count; i++)
+                    out[i] = (T)buffer[i];
+
+                break;
+            }
+            case 1:
+            {
+                float buffer[value_count];
+                memcpy(buffer, values, sizeof(buffer));
+                for (size_t i = 0; i < value_count; i++)
+                    out[i] = (T)buffer[i];
+
+                break;
+            }
+            case 2:
+            {
+                float prices[price_count];
+                uint16_t features[value_count - price_count];
+                memcpy(prices, values, sizeof(prices));
+                memcpy(features, values + sizeof(prices), sizeof(features));
+                for (size_t i = 0; i < price_count; i++)
+                    out[i] = (T)prices[i];
+                for (size_t i = 0; i < value_count - price_count; i++)
+                    out[price_count + i] = (T)from_bfloat16(features[i]);
+
+                break;
+            }
+            }
+        }
+    }
+}
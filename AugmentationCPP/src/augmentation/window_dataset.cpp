@@ -0,0 +1,155 @@
+#include "augmentation/window_dataset.hpp"
+#include "augmentation/row_format.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace program
+{
+    bool window_dataset::open(const std::filesystem::path& folder)
+    {
+        std::vector<std::filesystem::path> indexes;
+        for (const auto& entry : std::filesystem::directory_iterator(folder))
+            if (entry.path().extension() == ".windows")
+                indexes.push_back(entry.path());
+        // sample numbers must not depend on the directory order
+        std::sort(indexes.begin(), indexes.end());
+
+        for (const std::filesystem::path& index_file : indexes)
+        {
+            m_symbols.emplace_back();
+            symbol& s = m_symbols.back();
+
+            s.m_index = mapped_file(index_file);
+            if (s.m_index.size() < sizeof(window_index_header))
+                return false;
+
+            window_index_header header;
+            memcpy(&header, s.m_index.data(), sizeof(header));
+            if (memcmp(header.m_magic, window_index_header::magic, sizeof(header.m_magic)) || header.m_precision >= row_format::format_count)
+                return false;
+            if (m_window && header.m_window != m_window)
+                return false;
+            if (s.m_index.size() != sizeof(header) + header.m_window_count * sizeof(uint64_t))
+                return false;
+            m_window = header.m_window;
+
+            // symbols that are too short for a single window don't contribute samples
+            if (!header.m_window_count)
+            {
+                m_symbols.pop_back();
+
+                continue;
+            }
+
+            s.m_precision = header.m_precision;
+            s.m_row_size = row_format::row_sizes[header.m_precision];
+            s.m_starts = (const uint64_t*)(s.m_index.data() + sizeof(header));
+            s.m_window_count = header.m_window_count;
+
+            // samples are picked at random, read ahead would only pull in pages nobody asked for
+            s.m_rows = mapped_file(std::filesystem::path(index_file).replace_extension(".bin"), MADV_RANDOM);
+            if (s.m_rows.size() != header.m_row_count * s.m_row_size)
+                return false;
+
+            m_first_sample.push_back(m_sample_count);
+            m_sample_count += header.m_window_count;
+        }
+
+        return !m_symbols.empty();
+    }
+
+    void window_dataset::read_sample(size_t sample, float* out) const
+    {
+        const size_t symbol_index = std::upper_bound(m_first_sample.begin(), m_first_sample.end(), sample) - m_first_sample.begin() - 1;
+        const symbol& s = m_symbols[symbol_index];
+
+        const uint64_t start = s.m_starts[sample - m_first_sample[symbol_index]];
+        const uint8_t* row = s.m_rows.data() + start * s.m_row_size;
+
+        for (size_t r = 0; r < m_window; r++, row += s.m_row_size, out += feature_count)
+            row_format::decode(row, s.m_precision, out);
+    }
+
+    batch_reader::batch_reader(const window_dataset& dataset, size_t batch_size, uint64_t seed, size_t thread_count) :
+        m_dataset(dataset), m_batch_size(std::max<size_t>(batch_size, 1)), m_random(seed), m_order(dataset.sample_count())
+    {
+        if (!thread_count)
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        for (size_t i = 0; i < thread_count; i++)
+            m_workers.emplace_back(&batch_reader::work, this, i, thread_count);
+
+        this->reset();
+    }
+
+    batch_reader::~batch_reader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_start.notify_all();
+
+        for (std::thread& worker : m_workers)
+            worker.join();
+    }
+
+    size_t batch_reader::next(std::vector<float>& batch)
+    {
+        const size_t count = std::min(m_batch_size, m_order.size() - m_position);
+        if (!count)
+            return 0;
+
+        batch.resize(count * m_dataset.window() * window_dataset::feature_count);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_batch = batch.data();
+        m_batch_samples = m_order.data() + m_position;
+        m_batch_count = count;
+        m_busy_workers = m_workers.size();
+        m_generation++;
+        m_start.notify_all();
+
+        m_done.wait(lock, [this]() { return !m_busy_workers; });
+        m_position += count;
+
+        return count;
+    }
+
+    void batch_reader::reset()
+    {
+        std::iota(m_order.begin(), m_order.end(), 0);
+        std::shuffle(m_order.begin(), m_order.end(), m_random);
+        m_position = 0;
+    }
+
+    void batch_reader::work(size_t worker, size_t worker_count)
+    {
+        const size_t sample_size = m_dataset.window() * window_dataset::feature_count;
+        size_t generation = 0;
+
+        for (;;)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [&]() { return m_stopping || m_generation != generation; });
+            if (m_stopping)
+                return;
+
+            generation = m_generation;
+            float* batch = m_batch;
+            const size_t* samples = m_batch_samples;
+            const size_t count = m_batch_count;
+            lock.unlock();
+
+            // every worker decodes an interleaved share of the samples
+            for (size_t i = worker; i < count; i += worker_count)
+                m_dataset.read_sample(samples[i], batch + i * sample_size);
+
+            lock.lock();
+            if (!--m_busy_workers)
+                m_done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "augmentation/mapped_file.hpp"
+
+namespace program
+{
+    // Window index written next to every output file (<stem>.windows) when windows are exported.
+    // The header is followed by window_count uint64 row offsets of the windows that may be used as samples.
+    struct window_index_header
+    {
+        char m_magic[8];
+        // row format of the matching .bin file, the integer value of output_precision
+        uint32_t m_precision;
+        uint32_t m_window;
+        uint64_t m_row_count;
+        uint64_t m_window_count;
+
+        static constexpr char magic[8] = { 'A', 'U', 'G', 'W', 'I', 'N', '1', '\0' };
+    };
+    static_assert(sizeof(window_index_header) == 32, "window_index_header is part of the file format");
+
+    /**
+     * @brief Every valid window of the outputs in a folder, backed by read only mappings of the files.
+     * Samples are numbered over all symbols, a sample is window rows of feature_count float values.
+     */
+    class window_dataset final
+    {
+    public:
+        // open, close, high, low, volume followed by the ten indicators, the timestamp isn't a feature
+        static constexpr size_t feature_count = 15;
+
+    private:
+        struct symbol
+        {
+            mapped_file m_rows;
+            mapped_file m_index;
+            uint32_t m_precision;
+            size_t m_row_size;
+            const uint64_t* m_starts;
+            size_t m_window_count;
+        };
+
+        std::vector<symbol> m_symbols;
+        // m_first_sample[i] is the global number of the first sample of symbol i
+        std::vector<size_t> m_first_sample;
+        size_t m_window = 0;
+        size_t m_sample_count = 0;
+
+    public:
+        window_dataset() = default;
+        window_dataset(const window_dataset&) = delete;
+        window_dataset& operator=(const window_dataset&) = delete;
+
+        /**
+         * @brief Maps every .windows index of folder together with its .bin file.
+         * @return false when no index was found, the windows differ between files or a file is malformed
+         */
+        bool open(const std::filesystem::path& folder);
+
+        size_t sample_count() const
+        {
+            return m_sample_count;
+        }
+
+        size_t window() const
+        {
+            return m_window;
+        }
+
+        /**
+         * @brief Decodes sample into out, which holds window() * feature_count floats in time major order.
+         */
+        void read_sample(size_t sample, float* out) const;
+    };
+
+    /**
+     * @brief Assembles shuffled mini-batches of a window_dataset on a set of worker threads.
+     * Each epoch visits every sample once in a new order derived from the seed.
+     */
+    class batch_reader final
+    {
+        const window_dataset& m_dataset;
+        size_t m_batch_size;
+        std::mt19937_64 m_random;
+
+        std::vector<size_t> m_order;
+        size_t m_position = 0;
+
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_start;
+        std::condition_variable m_done;
+        // bumped for every batch, workers fill their share once per generation
+        size_t m_generation = 0;
+        size_t m_busy_workers = 0;
+        bool m_stopping = false;
+
+        // batch currently being assembled
+        float* m_batch = nullptr;
+        const size_t* m_batch_samples = nullptr;
+        size_t m_batch_count = 0;
+
+    public:
+        /**
+         * @param thread_count workers assembling a batch, 0 uses one per hardware thread
+         */
+        batch_reader(const window_dataset& dataset, size_t batch_size, uint64_t seed, size_t thread_count = 0);
+        batch_reader(const batch_reader&) = delete;
+        batch_reader& operator=(const batch_reader&) = delete;
+        ~batch_reader();
+
+        /**
+         * @brief Fills batch with the next samples as [sample][row][feature], the last batch of an epoch may be smaller.
+         * @return number of samples in the batch, 0 at the end of an epoch
+         */
+        size_t next(std::vector<float>& batch);
+
+        /**
+         * @brief Starts a new epoch with a fresh shuffle.
+         */
+        void reset();
+
+    private:
+        void work(size_t worker, size_t worker_count);
+    };
+}
@@ -0,0 +1,196 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "settings.hpp"
+#include "augmentation/mapped_file.hpp"
+#include "augmentation/row_format.hpp"
+
+namespace program
+{
+    enum class input_format
+    {
+        // text with a header line, see projected_csv_reader
+        csv,
+        // .bin output of a previous run, rows of the --input-precision format
+        candle_rows,
+        // ohlcv_header followed by the columns
+        ohlcv_columns
+    };
+
+    // Raw column input: the header is followed by row_count uint64 timestamps and row_count doubles of
+    // open, close, high, low and volume each, in that order.
+    struct ohlcv_header
+    {
+        char m_magic[8];
+        uint64_t m_row_count;
+
+        static constexpr char magic[8] = { 'A', 'U', 'G', 'O', 'H', 'L', '1', '\0' };
+    };
+    static_assert(sizeof(ohlcv_header) == 16, "ohlcv_header is part of the file format");
+
+    /**
+     * @brief Loads the prices of binary inputs through a read only mapping, without any text parsing.
+     * Only the timestamp and the five price columns are read, indicators of .bin inputs are computed again.
+     */
+    class binary_input final
+    {
+    public:
+        static constexpr size_t price_count = row_format::price_count;
+        // written into every output folder, the output fingerprint of the run that wrote its .bin files
+        static constexpr const char* run_settings_name = ".augmentation_settings";
+        static constexpr const char* precision_names[] = { "f64", "f32", "bf16" };
+
+        static bool write_run_settings(const std::filesystem::path& out_dir)
+        {
+            std::ofstream stream(out_dir / run_settings_name, std::ios::trunc);
+            stream << g_settings.output_fingerprint() << '\n';
+
+            return (bool)stream;
+        }
+
+        /**
+         * @brief Checks the run settings recorded next to a .bin output of a previous run before its prices are reused.
+         * Normalized prices or rows of another precision than --input-precision would be read as if they were raw candles.
+         * @param warning set when the folder has no record, the file is read but its prices can't be confirmed
+         * @return false with error set when the recorded settings rule the file out
+         */
+        static bool check_run_settings(const std::filesystem::path& file, std::string& warning, std::string& error)
+        {
+            std::ifstream stream(file.parent_path() / run_settings_name);
+            std::string fingerprint;
+            int output_format = -1, input_format = -1, normalization = -1;
+            const size_t precision_at = std::getline(stream, fingerprint) ? fingerprint.find(";precision=") : std::string::npos;
+            const size_t normalize_at = fingerprint.find(";normalize=");
+            if (precision_at == std::string::npos || normalize_at == std::string::npos
+                || sscanf(fingerprint.c_str() + precision_at, ";precision=%d,%d", &output_format, &input_format) != 2
+                || sscanf(fingerprint.c_str() + normalize_at, ";normalize=%d", &normalization) != 1)
+            {
+                warning = "no " + std::string(run_settings_name) + " next to it, make sure the run that wrote it had no --normalize and --precision " + precision_names[(int)g_settings.m_input_precision];
+
+                return true;
+            }
+
+            if (normalization != (int)normalization_mode::none)
+            {
+                error = "it holds normalized prices, reprocess the original input instead";
+
+                return false;
+            }
+            if (output_format != (int)g_settings.m_input_precision)
+            {
+                error = "it was written with another --precision, pass " + std::string(output_format >= 0 && output_format < 3 ? precision_names[output_format] : "that") + " as --input-precision";
+
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Files starting with the ohlcv magic are column inputs, other .bin files are outputs of a previous run.
+         */
+        static input_format detect(const std::filesystem::path& file)
+        {
+            char magic[sizeof(ohlcv_header::magic)]{};
+            std::ifstream stream(file, std::ios::binary);
+            if (stream.read(magic, sizeof(magic)) && !memcmp(magic, ohlcv_header::magic, sizeof(magic)))
+                return input_format::ohlcv_columns;
+
+            return file.extension() == ".bin" ? input_format::candle_rows : input_format::csv;
+        }
+
+        /**
+         * @param row called with the timestamp and the open, close, high, low and volume of every row
+         * @return false with error set when the file can't be mapped or its size doesn't match the format
+         */
+        template <typename Row>
+        static bool read(const std::filesystem::path& file, input_format format, output_precision precision, Row&& row, std::string& error)
+        {
+            std::error_code code;
+            const uintmax_t file_size = std::filesystem::file_size(file, code);
+            mapped_file map(file, MADV_SEQUENTIAL);
+            if (code || (file_size && !map.data()))
+            {
+                error = "can't map the file";
+
+                return false;
+            }
+
+            if (format == input_format::candle_rows)
+            {
+                const size_t row_size = row_format::row_sizes[(int)precision];
+                if (map.size() % row_size)
+                {
+                    error = "size is no multiple of the " + std::to_string(row_size) + " byte rows of the --input-precision format";
+
+                    return false;
+                }
+
+                double values[price_count];
+                for (size_t offset = 0; offset < map.size(); offset += row_size)
+                {
+                    decode_prices(map.data() + offset, precision, values);
+                    row(row_format::timestamp(map.data() + offset), values);
+                }
+
+                return true;
+            }
+
+            ohlcv_header header;
+            if (map.size() < sizeof(header))
+            {
+                error = "truncated header";
+
+                return false;
+            }
+            memcpy(&header, map.data(), sizeof(header));
+
+            const uint64_t row_count = header.m_row_count;
+            if (row_count > (map.size() - sizeof(header)) / (sizeof(uint64_t) + price_count * sizeof(double))
+                || map.size() != sizeof(header) + row_count * (sizeof(uint64_t) + price_count * sizeof(double)))
+            {
+                error = "size doesn't match the row count of the header";
+
+                return false;
+            }
+
+            // the 16 byte header keeps every column 8 byte aligned inside the page aligned mapping
+            const uint64_t* timestamps = (const uint64_t*)(map.data() + sizeof(header));
+            const double* columns = (const double*)(timestamps + row_count);
+
+            double values[price_count];
+            for (uint64_t i = 0; i < row_count; i++)
+            {
+                for (size_t c = 0; c < price_count; c++)
+                    values[c] = columns[c * row_count + i];
+                row(timestamps[i], values);
+            }
+
+            return true;
+        }
+
+    private:
+        // all row formats start with the prices, as doubles (f64) or floats (f32, bf16)
+        static void decode_prices(const uint8_t* row, output_precision precision, double* out)
+        {
+            const uint8_t* values = row + sizeof(uint64_t);
+
+            if (precision == output_precision::f64)
+            {
+                memcpy(out, values, price_count * sizeof(double));
+
+                return;
+            }
+
+            float prices[price_count];
+            memcpy(prices, values, sizeof(prices));
+            for (size_t i = 0; i < price_count; i++)
+                out[i] = prices[i];
+        }
+    };
+}
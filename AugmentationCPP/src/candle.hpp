@@ -11,24 +11,46 @@ struct candle
     double m_low;
     double m_volume;
 
-    // indicators
-    double m_adosc;
+    // indicators, candles inside the lookback period of an indicator keep 0
+    double m_adosc = 0;
 
-    double m_atr;
+    double m_atr = 0;
 
-    double m_macd;
-    double m_macd_signal;
-    double m_macd_hist;
+    double m_macd = 0;
+    double m_macd_signal = 0;
+    double m_macd_hist = 0;
 
-    double m_mfi;
+    double m_mfi = 0;
 
-    double m_upper_band;
-    double m_middle_band;
-    double m_lower_band;
+    double m_upper_band = 0;
+    double m_middle_band = 0;
+    double m_lower_band = 0;
 
-    double m_rsi;
+    double m_rsi = 0;
 
+    // every double column from m_open up to m_rsi, in memory order
+    static constexpr size_t value_count = 15;
+    // the first price_count values are prices and volume, the rest are indicator features
+    static constexpr size_t price_count = 5;
+    static constexpr const char* value_names[value_count] = {
+        "open", "close", "high", "low", "volume",
+        "adosc",
+        "atr",
+        "macd", "macd_signal", "macd_hist",
+        "mfi",
+        "upper_band", "middle_band", "lower_band",
+        "rsi"
+    };
 
+    const double* values() const
+    {
+        return &m_open;
+    }
+
+    double* values()
+    {
+        return &m_open;
+    }
 
     candle() = default;
     candle(double timestamp, double open, double close, double high, double low, double volume)
@@ -41,3 +63,6 @@ struct candle
         m_volume = volume;
     }
 };
+
+static_assert(offsetof(candle, m_rsi) == offsetof(candle, m_open) + (candle::value_count - 1) * sizeof(double),
+    "candle::values() expects all double columns to be contiguous");
@@ -9,8 +9,15 @@
 #include "util/csv.h"
 #include "util/CSVWriter.h"
 
+#include "directory_watcher.hpp"
 #include "logger.hpp"
+#include "metrics_exporter.hpp"
+#include "result_cache.hpp"
+#include "settings.hpp"
+#include "shard_plan.hpp"
+#include "stream_server.hpp"
 #include "thread_pool.hpp"
+#include "uring_queue.hpp"
 
 namespace program
 {
@@ -0,0 +1,198 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <strings.h>
+
+#include "timestamp_parser.hpp"
+#include "util/csv.h"
+
+namespace program
+{
+    /**
+     * @brief Number parser of io::CSVReader that also accepts nan, inf and infinity (any case, optionally signed),
+     * so exports with missing values reach input_validator and --validate decides what happens to those rows.
+     * @throws std::exception of io::CSVReader for anything else that isn't a number
+     */
+    inline void parse_value(char* column, double& value)
+    {
+        const char* word = column + (*column == '-' || *column == '+');
+        if ((*word | 0x20) == 'n' || (*word | 0x20) == 'i')
+        {
+            const bool negative = *column == '-';
+            if (!strcasecmp(word, "nan"))
+            {
+                value = std::nan("");
+
+                return;
+            }
+            if (!strcasecmp(word, "inf") || !strcasecmp(word, "infinity"))
+            {
+                value = negative ? -INFINITY : INFINITY;
+
+                return;
+            }
+        }
+
+        io::detail::parse<io::throw_on_overflow>(column, value);
+    }
+
+    /**
+     * @brief CSV reader that only touches the columns it was asked for.
+     * The header is matched against the requested names once. Rows are then split with strchr up to the last
+     * requested column only: skipped columns are neither trimmed nor terminated nor converted, and everything
+     * behind the last requested column is never scanned, so wide exports cost about as much as narrow files.
+     * Lines come from io::LineReader, quoting isn't supported (like the io::CSVReader configuration it replaces).
+     */
+    template <size_t column_count>
+    class projected_csv_reader final
+    {
+        io::LineReader m_lines;
+        // requested column of every input column up to the last requested one, -1 for skipped columns
+        std::vector<int> m_projection;
+
+    public:
+        template <typename... Args>
+        explicit projected_csv_reader(Args&&... args) :
+            m_lines(std::forward<Args>(args)...)
+        {
+
+        }
+
+        /**
+         * @brief Finds the requested columns in the header line.
+         * @throws std::runtime_error when the header is missing or lacks one of the names
+         */
+        void read_header(const std::array<std::string, column_count>& names)
+        {
+            char* line = m_lines.next_line();
+            if (!line)
+                this->fail("header missing");
+
+            std::array<bool, column_count> found{};
+            size_t remaining = column_count;
+            for (char* column = line; column && remaining; )
+            {
+                char* end = strchr(column, ',');
+                if (end)
+                    *end = '\0';
+
+                char* text_end = column + strlen(column);
+                trim(column, text_end);
+                *text_end = '\0';
+
+                int target = -1;
+                for (size_t i = 0; i < column_count; i++)
+                    if (!found[i] && names[i] == column)
+                    {
+                        found[i] = true;
+                        target = (int)i;
+                        remaining--;
+
+                        break;
+                    }
+                m_projection.push_back(target);
+
+                column = end ? end + 1 : nullptr;
+            }
+
+            for (size_t i = 0; i < column_count; i++)
+                if (!found[i])
+                    this->fail(("column \"" + names[i] + "\" missing in header").c_str());
+        }
+
+        /**
+         * @brief Splits the next row, columns[i] receives the trimmed and null terminated text of requested column i.
+         * @return false at the end of the input
+         * @throws std::runtime_error when a row ends before the last requested column
+         */
+        bool read_row(std::array<char*, column_count>& columns)
+        {
+            char* line = m_lines.next_line();
+            if (!line)
+                return false;
+
+            char* column = line;
+            for (int target : m_projection)
+            {
+                if (!column)
+                    this->fail("too few columns");
+
+                char* end = strchr(column, ',');
+                if (target >= 0)
+                {
+                    char* text_end = end ? end : column + strlen(column);
+                    trim(column, text_end);
+                    *text_end = '\0';
+                    columns[target] = column;
+                }
+
+                column = end ? end + 1 : nullptr;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Converts the requested columns of the next row with parse_value.
+         */
+        bool read_row(std::array<double, column_count>& values)
+        {
+            std::array<char*, column_count> columns;
+            if (!this->read_row(columns))
+                return false;
+
+            for (size_t i = 0; i < column_count; i++)
+                parse(columns[i], values[i]);
+
+            return true;
+        }
+
+        void parse(char* column, double& value) const
+        {
+            try
+            {
+                parse_value(column, value);
+            }
+            catch (const std::exception& e)
+            {
+                this->fail((std::string(e.what()) + " in \"" + column + "\"").c_str());
+            }
+        }
+
+        uint64_t parse(const char* column, timestamp_parser& parser) const
+        {
+            try
+            {
+                return parser.parse(column);
+            }
+            catch (const std::exception& e)
+            {
+                this->fail((std::string(e.what()) + " \"" + column + "\"").c_str());
+            }
+        }
+
+    private:
+        // moves begin and end inwards past spaces and tabs
+        static void trim(char*& begin, char*& end)
+        {
+            while (begin < end && (*begin == ' ' || *begin == '\t'))
+                begin++;
+            while (end > begin && (end[-1] == ' ' || end[-1] == '\t'))
+                end--;
+        }
+
+        [[noreturn]] void fail(const char* message) const
+        {
+            char buffer[512];
+            snprintf(buffer, sizeof(buffer), "%s (line %u of %s)", message, m_lines.get_file_line(), m_lines.get_truncated_file_name());
+
+            throw std::runtime_error(buffer);
+        }
+    };
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "logger.hpp"
+
+namespace program
+{
+    /**
+     * @brief Reports files of a folder once they were closed after writing or moved into it.
+     */
+    class directory_watcher final
+    {
+        std::filesystem::path m_folder;
+        int m_fd = -1;
+        int m_watch = -1;
+
+    public:
+        explicit directory_watcher(const std::filesystem::path& folder) :
+            m_folder(folder)
+        {
+            m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (m_fd < 0)
+            {
+                g_log->error("WATCHER", "inotify_init1 failed: %s", strerror(errno));
+
+                return;
+            }
+
+            // files written in place show up with IN_CLOSE_WRITE, atomically renamed ones with IN_MOVED_TO
+            m_watch = inotify_add_watch(m_fd, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (m_watch < 0)
+                g_log->error("WATCHER", "Failed to watch %s: %s", folder.c_str(), strerror(errno));
+        }
+
+        directory_watcher(const directory_watcher&) = delete;
+        directory_watcher& operator=(const directory_watcher&) = delete;
+
+        ~directory_watcher()
+        {
+            if (m_fd >= 0)
+                close(m_fd);
+        }
+
+        bool is_valid() const
+        {
+            return m_fd >= 0 && m_watch >= 0;
+        }
+
+        /**
+         * @brief Waits up to timeout_ms for events and appends the files that are ready.
+         * Hidden files are ignored so temporary files of collectors don't get picked up.
+         * @param overflowed set when the kernel dropped events, the caller has to rescan the folder
+         * @return false if waiting failed for a reason other than a signal
+         */
+        bool poll(std::vector<std::filesystem::path>& ready, bool& overflowed, int timeout_ms)
+        {
+            overflowed = false;
+            pollfd poll_fd{ m_fd, POLLIN, 0 };
+
+            const int result = ::poll(&poll_fd, 1, timeout_ms);
+            if (result < 0)
+                return errno == EINTR;
+            if (result == 0)
+                return true;
+
+            alignas(inotify_event) char buffer[16 * 1024];
+            for (;;)
+            {
+                const ssize_t length = read(m_fd, buffer, sizeof(buffer));
+                if (length <= 0)
+                    break;
+
+                for (ssize_t offset = 0; offset < length;)
+                {
+                    const inotify_event* event = (const inotify_event*)(buffer + offset);
+                    offset += sizeof(inotify_event) + event->len;
+
+                    if (event->mask & IN_Q_OVERFLOW)
+                    {
+                        g_log->warning("WATCHER", "Event queue overflowed, rescanning %s.", m_folder.c_str());
+                        overflowed = true;
+                    }
+
+                    if (!event->len || event->name[0] == '.' || (event->mask & IN_ISDIR))
+                        continue;
+
+                    ready.push_back(m_folder / event->name);
+                }
+            }
+
+            return true;
+        }
+    };
+}
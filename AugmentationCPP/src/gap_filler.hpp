@@ -0,0 +1,238 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "candle.hpp"
+#include "augmentation/cpu_dispatch.hpp"
+#include "settings.hpp"
+
+namespace program
+{
+    struct gap_report
+    {
+        // spacing the timestamps are expected to have
+        uint64_t m_interval = 0;
+        size_t m_rows_in = 0;
+        size_t m_rows_out = 0;
+        size_t m_gaps = 0;
+        size_t m_missing_rows = 0;
+        size_t m_duplicates = 0;
+        size_t m_out_of_order = 0;
+        uint64_t m_largest_gap = 0;
+        // rows inserted by the fill policy and gaps left open because they exceeded the fill limits
+        size_t m_filled_rows = 0;
+        size_t m_unfilled_gaps = 0;
+        // first and last missing timestamp of the first max_ranges gaps
+        std::vector<std::pair<uint64_t, uint64_t>> m_ranges;
+
+        static constexpr size_t max_ranges = 1000;
+
+        std::string to_json() const
+        {
+            char buffer[512];
+            snprintf(buffer, sizeof(buffer),
+                "{\"interval\":%llu,\"rows_in\":%zu,\"rows_out\":%zu,\"gaps\":%zu,\"missing_rows\":%zu,\"duplicates\":%zu,\"out_of_order\":%zu,\"largest_gap\":%llu,\"filled_rows\":%zu,\"unfilled_gaps\":%zu,\"ranges\":[",
+                (unsigned long long)m_interval, m_rows_in, m_rows_out, m_gaps, m_missing_rows, m_duplicates, m_out_of_order, (unsigned long long)m_largest_gap,
+                m_filled_rows, m_unfilled_gaps);
+
+            std::string json = buffer;
+            for (size_t i = 0; i < m_ranges.size(); i++)
+            {
+                snprintf(buffer, sizeof(buffer), "%s[%llu,%llu]", i ? "," : "", (unsigned long long)m_ranges[i].first, (unsigned long long)m_ranges[i].second);
+                json += buffer;
+            }
+            json += "]}\n";
+
+            return json;
+        }
+    };
+
+    /**
+     * @brief Repairs the time index of a symbol before the indicators see it.
+     * Clean files only pay for one vectorized scan over the timestamps. Files with anomalies are put in order
+     * (out of order rows are sorted in, duplicated timestamps keep their first row) and gaps are filled
+     * according to the policy. Candles are moved by pointer, their data is never copied.
+     * A gap is only filled when it misses at most max_fill rows and the file's filled rows stay below its input rows,
+     * so a single corrupt timestamp can't blow a file up to billions of rows. Larger gaps stay open and are reported.
+     */
+    class gap_filler final
+    {
+        struct scan_result
+        {
+            size_t m_out_of_order = 0;
+            size_t m_duplicates = 0;
+            size_t m_gaps = 0;
+        };
+
+    public:
+        /**
+         * @brief Most common positive spacing of the first rows, 0 if there is none.
+         */
+        static uint64_t detect_interval(const std::vector<uint64_t>& timestamps)
+        {
+            std::unordered_map<uint64_t, size_t> counts;
+
+            const size_t sample = std::min<size_t>(timestamps.size(), 4096);
+            for (size_t i = 1; i < sample; i++)
+                if (timestamps[i] > timestamps[i - 1])
+                    counts[timestamps[i] - timestamps[i - 1]]++;
+
+            uint64_t interval = 0;
+            size_t best = 0;
+            for (const auto& [spacing, count] : counts)
+                if (count > best || (count == best && spacing < interval))
+                {
+                    interval = spacing;
+                    best = count;
+                }
+
+            return interval;
+        }
+
+        /**
+         * @param interval expected spacing, 0 detects it from the data
+         */
+        static gap_report repair(std::vector<std::unique_ptr<candle>>& candles, gap_policy policy, uint64_t interval, size_t max_fill)
+        {
+            gap_report report;
+            report.m_rows_in = candles.size();
+
+            std::vector<uint64_t> timestamps = gather(candles);
+            report.m_interval = interval ? interval : detect_interval(timestamps);
+
+            scan_result scan = scan_timestamps(timestamps.data(), timestamps.size(), report.m_interval);
+            report.m_out_of_order = scan.m_out_of_order;
+
+            const bool fills_gaps = policy != gap_policy::drop && report.m_interval;
+            if (scan.m_out_of_order || scan.m_duplicates || (scan.m_gaps && fills_gaps))
+            {
+                if (scan.m_out_of_order)
+                {
+                    std::stable_sort(candles.begin(), candles.end(),
+                        [](const std::unique_ptr<candle>& a, const std::unique_ptr<candle>& b) { return a->m_timestamp < b->m_timestamp; });
+                    timestamps = gather(candles);
+                    scan = scan_timestamps(timestamps.data(), timestamps.size(), report.m_interval);
+                }
+
+                rebuild(candles, policy, max_fill, report, scan);
+            }
+            else
+            {
+                // nothing to repair, only describe the gaps
+                for (size_t i = 1; i < timestamps.size(); i++)
+                    if (timestamps[i] - timestamps[i - 1] > report.m_interval)
+                        record_gap(report, timestamps[i - 1], timestamps[i]);
+            }
+
+            report.m_rows_out = candles.size();
+
+            return report;
+        }
+
+    private:
+        static std::vector<uint64_t> gather(const std::vector<std::unique_ptr<candle>>& candles)
+        {
+            std::vector<uint64_t> timestamps(candles.size());
+            for (size_t i = 0; i < candles.size(); i++)
+                timestamps[i] = candles[i]->m_timestamp;
+
+            return timestamps;
+        }
+
+        // branch free counting so the loop turns into packed compares and adds
+        AUGMENTATION_KERNEL static scan_result scan_timestamps(const uint64_t* timestamps, size_t count, uint64_t interval)
+        {
+            size_t out_of_order = 0, duplicates = 0, gaps = 0;
+
+            for (size_t i = 1; i < count; i++)
+            {
+                const int64_t delta = (int64_t)(timestamps[i] - timestamps[i - 1]);
+                out_of_order += delta < 0;
+                duplicates += delta == 0;
+                gaps += interval && delta > (int64_t)interval;
+            }
+
+            return { out_of_order, duplicates, gaps };
+        }
+
+        static void record_gap(gap_report& report, uint64_t previous, uint64_t next)
+        {
+            report.m_gaps++;
+            report.m_largest_gap = std::max(report.m_largest_gap, next - previous);
+            report.m_missing_rows += (next - previous - 1) / report.m_interval;
+
+            if (report.m_ranges.size() < gap_report::max_ranges)
+                report.m_ranges.emplace_back(previous + report.m_interval, next - report.m_interval);
+        }
+
+        static void rebuild(std::vector<std::unique_ptr<candle>>& candles, gap_policy policy, size_t max_fill, gap_report& report, const scan_result& scan)
+        {
+            const bool fills_gaps = policy != gap_policy::drop && report.m_interval;
+
+            std::vector<std::unique_ptr<candle>> repaired;
+            repaired.reserve(candles.size() - scan.m_duplicates);
+
+            for (std::unique_ptr<candle>& current : candles)
+            {
+                if (repaired.empty())
+                {
+                    repaired.push_back(std::move(current));
+
+                    continue;
+                }
+
+                const candle& previous = *repaired.back();
+                if (current->m_timestamp == previous.m_timestamp)
+                {
+                    report.m_duplicates++;
+
+                    continue;
+                }
+
+                if (report.m_interval && current->m_timestamp - previous.m_timestamp > report.m_interval)
+                {
+                    const uint64_t previous_timestamp = previous.m_timestamp;
+                    record_gap(report, previous_timestamp, current->m_timestamp);
+
+                    const uint64_t missing = (current->m_timestamp - previous_timestamp - 1) / report.m_interval;
+                    if (fills_gaps && (missing > max_fill || report.m_filled_rows + missing > report.m_rows_in))
+                        report.m_unfilled_gaps++;
+                    else if (fills_gaps)
+                    {
+                        for (uint64_t timestamp = previous_timestamp + report.m_interval; timestamp < current->m_timestamp; timestamp += report.m_interval)
+                            repaired.push_back(fill_candle(*repaired.back(), timestamp, policy));
+                        report.m_filled_rows += missing;
+                    }
+                }
+
+                repaired.push_back(std::move(current));
+            }
+
+            candles = std::move(repaired);
+        }
+
+        static std::unique_ptr<candle> fill_candle(const candle& previous, uint64_t timestamp, gap_policy policy)
+        {
+            std::unique_ptr<candle> filled;
+            if (policy == gap_policy::ffill)
+            {
+                // repeat the last candle
+                filled = std::make_unique<candle>((double)previous.m_timestamp, previous.m_open, previous.m_close, previous.m_high, previous.m_low, previous.m_volume);
+            }
+            else
+            {
+                // flat bar at the last close without trades
+                filled = std::make_unique<candle>((double)previous.m_timestamp, previous.m_close, previous.m_close, previous.m_close, previous.m_close, 0.0);
+            }
+            filled->m_timestamp = timestamp;
+
+            return filled;
+        }
+    };
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+namespace program
+{
+    namespace hash
+    {
+        inline uint64_t mix(uint64_t value)
+        {
+            value ^= value >> 33;
+            value *= 0xff51afd7ed558ccdULL;
+            value ^= value >> 33;
+            value *= 0xc4ceb9fe1a85ec53ULL;
+            value ^= value >> 33;
+
+            return value;
+        }
+
+        /**
+         * @brief Fast non-cryptographic 64 bit hash, four independent lanes keep the multiplier pipelines busy.
+         */
+        inline uint64_t bytes(const void* data, size_t size, uint64_t seed = 0)
+        {
+            constexpr uint64_t prime = 0x9e3779b97f4a7c15ULL;
+
+            const unsigned char* input = (const unsigned char*)data;
+            uint64_t lanes[4] = { seed + prime, seed ^ prime, seed - prime, ~seed };
+
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    uint64_t word;
+                    memcpy(&word, input + i + lane * 8, sizeof(word));
+
+                    lanes[lane] = (lanes[lane] ^ word) * prime;
+                    lanes[lane] ^= lanes[lane] >> 29;
+                }
+            }
+
+            uint64_t result = mix(lanes[0]) ^ mix(lanes[1] + 1) ^ mix(lanes[2] + 2) ^ mix(lanes[3] + 3) ^ size;
+            for (; i < size; i++)
+                result = (result ^ input[i]) * prime;
+
+            return mix(result);
+        }
+
+        inline uint64_t string(std::string_view value, uint64_t seed = 0)
+        {
+            return bytes(value.data(), value.size(), seed);
+        }
+
+        /**
+         * @brief Hashes a whole file in 1MiB blocks.
+         * @return 0 if the file could not be read
+         */
+        inline uint64_t file(const std::filesystem::path& path)
+        {
+            FILE* file = fopen(path.c_str(), "rb");
+            if (!file)
+                return 0;
+
+            constexpr size_t block_size = 1 << 20;
+            std::unique_ptr<char[]> buffer(new char[block_size]);
+
+            uint64_t result = 0;
+            size_t read;
+            while ((read = fread(buffer.get(), 1, block_size, file)) > 0)
+                result = bytes(buffer.get(), read, result);
+
+            fclose(file);
+
+            return result;
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <array>
+#include <iterator>
+
+#include "candle.hpp"
+#include "augmentation/indicators.hpp"
+
+namespace program
+{
+    // Every indicator of the schema lists its output columns three times, in the same order: the column name,
+    // the candle field that stores it and the output_columns slot compute_indicators fills for it.
+    namespace schema
+    {
+        struct adosc
+        {
+            static constexpr const char* names[] = { "adosc" };
+            static constexpr double candle::* fields[] = { &candle::m_adosc };
+            static constexpr double* output_columns::* outputs[] = { &output_columns::m_adosc };
+        };
+
+        struct atr
+        {
+            static constexpr const char* names[] = { "atr" };
+            static constexpr double candle::* fields[] = { &candle::m_atr };
+            static constexpr double* output_columns::* outputs[] = { &output_columns::m_atr };
+        };
+
+        struct bbands
+        {
+            static constexpr const char* names[] = { "upper_band", "middle_band", "lower_band" };
+            static constexpr double candle::* fields[] = { &candle::m_upper_band, &candle::m_middle_band, &candle::m_lower_band };
+            static constexpr double* output_columns::* outputs[] = { &output_columns::m_upper_band, &output_columns::m_middle_band, &output_columns::m_lower_band };
+        };
+
+        struct macd
+        {
+            static constexpr const char* names[] = { "macd", "macd_signal", "macd_hist" };
+            static constexpr double candle::* fields[] = { &candle::m_macd, &candle::m_macd_signal, &candle::m_macd_hist };
+            static constexpr double* output_columns::* outputs[] = { &output_columns::m_macd, &output_columns::m_macd_signal, &output_columns::m_macd_hist };
+        };
+
+        struct mfi
+        {
+            static constexpr const char* names[] = { "mfi" };
+            static constexpr double candle::* fields[] = { &candle::m_mfi };
+            static constexpr double* output_columns::* outputs[] = { &output_columns::m_mfi };
+        };
+
+        struct rsi
+        {
+            static constexpr const char* names[] = { "rsi" };
+            static constexpr double candle::* fields[] = { &candle::m_rsi };
+            static constexpr double* output_columns::* outputs[] = { &output_columns::m_rsi };
+        };
+
+        template <typename T, size_t... N>
+        constexpr std::array<T, (N + ...)> concat(const T (&... parts)[N])
+        {
+            std::array<T, (N + ...)> joined{};
+            size_t index = 0;
+            auto append = [&](const auto& part)
+            {
+                for (const T& value : part)
+                    joined[index++] = value;
+            };
+            (append(parts), ...);
+
+            return joined;
+        }
+    }
+
+    /**
+     * @brief Column layout generated at compile time from a list of indicators.
+     * The list decides which indicators compute_indicators runs (columns outside of it are never bound, so TA-Lib
+     * skips them), the size of the column block, the order of the CSV columns and which candle fields are filled.
+     * All loops run over constexpr arrays and are unrolled by the compiler, nothing is dispatched at runtime.
+     */
+    template <typename... Indicators>
+    struct indicator_schema
+    {
+        static constexpr std::array<const char*, (std::size(Indicators::names) + ...)> names = schema::concat(Indicators::names...);
+        static constexpr std::array<double candle::*, names.size()> fields = schema::concat(Indicators::fields...);
+        static constexpr std::array<double* output_columns::*, names.size()> outputs = schema::concat(Indicators::outputs...);
+        static constexpr size_t column_count = names.size();
+
+        static_assert(fields.size() == column_count && outputs.size() == column_count, "every indicator column needs a name, a field and an output");
+
+        /**
+         * @brief Points the outputs of the schema at consecutive columns of block, each stride doubles long.
+         */
+        static void bind(output_columns& output, double* block, size_t stride)
+        {
+            for (size_t c = 0; c < column_count; c++)
+                output.*outputs[c] = block + c * stride;
+        }
+
+        /**
+         * @brief Copies row of the column block bound by bind() into the candle.
+         */
+        static void scatter(const double* block, size_t stride, size_t row, candle& target)
+        {
+            for (size_t c = 0; c < column_count; c++)
+                target.*fields[c] = block[c * stride + row];
+        }
+
+        template <typename Writer>
+        static void write_header(Writer& writer)
+        {
+            writer << "event_time" << "open" << "close" << "high" << "low" << "volume";
+            for (const char* name : names)
+                writer << name;
+        }
+
+        template <typename Writer>
+        static void write_row(Writer& writer, const candle& source)
+        {
+            writer << source.m_timestamp << source.m_open << source.m_close << source.m_high << source.m_low << source.m_volume;
+            for (double candle::* field : fields)
+                writer << source.*field;
+        }
+    };
+
+    // Indicators of every output, in CSV column order. Removing an entry drops its computation at compile time,
+    // its candle fields then keep 0 in the fixed width binary rows.
+    using output_schema = indicator_schema<schema::adosc, schema::atr, schema::bbands, schema::macd, schema::mfi, schema::rsi>;
+}
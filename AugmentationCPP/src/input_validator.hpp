@@ -0,0 +1,138 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+#include "candle.hpp"
+
+namespace program
+{
+    /**
+     * @brief Checks the invariants of every parsed row and collects statistics of the input columns.
+     * check() runs inside the parse loop on values that are still in registers, so validation doesn't
+     * cost another pass over the data.
+     */
+    class input_validator final
+    {
+    public:
+        enum violation : uint32_t
+        {
+            // NaN or infinite value
+            not_a_number = 1 << 0,
+            negative_volume = 1 << 1,
+            // high < low
+            inverted_range = 1 << 2,
+            // a price <= 0
+            non_positive_price = 1 << 3,
+            // open or close outside of [low, high]
+            outside_range = 1 << 4
+        };
+
+    private:
+        static constexpr size_t violation_count = 5;
+        static constexpr const char* violation_names[violation_count] = {
+            "nan", "negative_volume", "high_below_low", "non_positive_price", "outside_high_low"
+        };
+
+        struct column_stats
+        {
+            double m_min = std::numeric_limits<double>::infinity();
+            double m_max = -std::numeric_limits<double>::infinity();
+            double m_sum = 0.0;
+            size_t m_count = 0;
+            size_t m_nan = 0;
+        };
+
+        column_stats m_columns[candle::price_count];
+        size_t m_violations[violation_count]{};
+        size_t m_rows = 0;
+        size_t m_invalid_rows = 0;
+        // first data row (1 based, without the header) that broke an invariant, 0 if none did
+        size_t m_first_invalid_row = 0;
+
+    public:
+        /**
+         * @param values open, close, high, low and volume of a row
+         * @return mask of the violated invariants, 0 for a valid row
+         */
+        uint32_t check(const double* values)
+        {
+            const double open = values[0], close = values[1], high = values[2], low = values[3], volume = values[4];
+
+            bool any_nan = false;
+            for (size_t i = 0; i < candle::price_count; i++)
+            {
+                const double value = values[i];
+                const bool nan = !std::isfinite(value);
+                column_stats& column = m_columns[i];
+
+                column.m_min = nan || column.m_min <= value ? column.m_min : value;
+                column.m_max = nan || column.m_max >= value ? column.m_max : value;
+                column.m_sum += nan ? 0.0 : value;
+                column.m_count += !nan;
+                column.m_nan += nan;
+                any_nan |= nan;
+            }
+
+            const uint32_t violations =
+                (any_nan ? (uint32_t)not_a_number : 0u)
+                | (volume < 0.0 ? (uint32_t)negative_volume : 0u)
+                | (high < low ? (uint32_t)inverted_range : 0u)
+                | ((open <= 0.0) | (close <= 0.0) | (high <= 0.0) | (low <= 0.0) ? (uint32_t)non_positive_price : 0u)
+                | ((open > high) | (open < low) | (close > high) | (close < low) ? (uint32_t)outside_range : 0u);
+
+            for (size_t i = 0; i < violation_count; i++)
+                m_violations[i] += (violations >> i) & 1;
+
+            m_rows++;
+            if (violations)
+            {
+                m_invalid_rows++;
+                if (!m_first_invalid_row)
+                    m_first_invalid_row = m_rows;
+            }
+
+            return violations;
+        }
+
+        size_t invalid_rows() const
+        {
+            return m_invalid_rows;
+        }
+
+        std::string to_json(size_t dropped_rows) const
+        {
+            char buffer[512];
+            snprintf(buffer, sizeof(buffer), "{\"rows\":%zu,\"invalid_rows\":%zu,\"dropped_rows\":%zu,\"first_invalid_row\":%zu,\"violations\":{",
+                m_rows, m_invalid_rows, dropped_rows, m_first_invalid_row);
+
+            std::string json = buffer;
+            for (size_t i = 0; i < violation_count; i++)
+            {
+                snprintf(buffer, sizeof(buffer), "%s\"%s\":%zu", i ? "," : "", violation_names[i], m_violations[i]);
+                json += buffer;
+            }
+
+            json += "},\"columns\":{";
+            for (size_t i = 0; i < candle::price_count; i++)
+            {
+                const column_stats& column = m_columns[i];
+
+                // columns without a single finite value report null, JSON has no infinity
+                if (column.m_count)
+                    snprintf(buffer, sizeof(buffer), "%s\"%s\":{\"min\":%.17g,\"max\":%.17g,\"mean\":%.17g,\"nan\":%zu}",
+                        i ? "," : "", candle::value_names[i], column.m_min, column.m_max, column.m_sum / column.m_count, column.m_nan);
+                else
+                    snprintf(buffer, sizeof(buffer), "%s\"%s\":{\"min\":null,\"max\":null,\"mean\":null,\"nan\":%zu}",
+                        i ? "," : "", candle::value_names[i], column.m_nan);
+                json += buffer;
+            }
+            json += "}}\n";
+
+            return json;
+        }
+    };
+}
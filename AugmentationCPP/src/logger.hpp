@@ -77,6 +77,12 @@ namespace program
             this->m_log_level = level;
         }
 
+        // e.g. std::cerr when stdout carries data
+        void set_output(std::ostream& output)
+        {
+            this->m_output = &output;
+        }
+
     private:
         const char* blue = "\x1b[34m";
         const char* green = "\x1b[32m";
@@ -85,6 +91,7 @@ namespace program
         const char* reset = "\x1b[0m";
 
         LogLevel m_log_level = LogLevel::Verbose;
+        std::ostream* m_output = &std::cout;
 
         LOG_ARGS
             void log(LogLevel level, const char* service, const char* format, Args&& ...args)
@@ -130,7 +137,7 @@ namespace program
             sprintf(message, format, std::forward<Args>(args)...);
 
             std::lock_guard<std::mutex> lock(this->mutex);
-            std::cout << color << "[" << level_string << "/" << service << "] " << reset << message << std::endl;
+            *m_output << color << "[" << level_string << "/" << service << "] " << reset << message << std::endl;
 
             // be a good boy and free memory
             free(message);
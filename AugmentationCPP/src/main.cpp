@@ -1,9 +1,50 @@
 #include "common.hpp"
 #include "symbol_processor.hpp"
+#include <csignal>
 #include <exception>
+#include <functional>
+#include <set>
 
 using namespace program;
 
+static std::atomic<bool> s_running = true;
+
+static void on_stop_signal(int)
+{
+    s_running = false;
+}
+
+/**
+ * @brief Aligns every .bin output of the folder on a shared timestamp index, writes panel.dat and panel.symbols.
+ */
+static bool build_panel(const std::filesystem::path& output_folder)
+{
+    std::vector<std::filesystem::path> outputs;
+    for (const auto& entry : std::filesystem::directory_iterator(output_folder))
+        if (entry.is_regular_file() && entry.path().extension() == ".bin")
+            outputs.push_back(entry.path());
+    std::sort(outputs.begin(), outputs.end());
+
+    const std::filesystem::path panel_file = output_folder / "panel.dat";
+
+    panel_builder builder;
+    if (!builder.build(outputs, (uint32_t)g_settings.m_output_precision, g_settings.m_panel_layout, panel_file))
+    {
+        g_log->error("MAIN", "Failed to build the panel: %s", builder.error().c_str());
+
+        return false;
+    }
+
+    // row order of the symbols in the panel
+    std::ofstream symbols(output_folder / "panel.symbols", std::ios::trunc);
+    for (const std::filesystem::path& output : outputs)
+        symbols << output.stem().string() << '\n';
+
+    g_log->info("MAIN", "Built a panel of %d symbols in %s.", outputs.size(), panel_file.c_str());
+
+    return true;
+}
+
 /**
  * @param {number} argc Argument count
  * @param {Array<char*>} argv Array of arguments
@@ -14,8 +55,32 @@ int main(int argc, const char** argv)
     g_log->set_log_level(Logger::LogLevel::Info);
 #endif
 
-    g_log->info("MAIN", "Initiating thread pool.");
-    auto thread_pool_instance = std::make_unique<thread_pool>();
+    // streaming mode works without folders, so its flags start right away
+    if (argc >= 2 && !strcmp(argv[1], "--stream"))
+    {
+        if (!g_settings.parse(argc, argv, 1))
+        {
+            g_log->error("MAIN", "Invalid arguments, usage: --stream stdin|unix:<path>");
+
+            return 1;
+        }
+
+        // stdout carries the indicator lines
+        if (g_settings.m_stream_source == "stdin")
+            g_log->set_output(std::cerr);
+
+        stream_server server;
+        if (!server.init(g_settings.m_stream_source))
+            return 1;
+
+        std::signal(SIGINT, on_stop_signal);
+        std::signal(SIGTERM, on_stop_signal);
+
+        server.run(s_running);
+        g_log->info("MAIN", "Stream closed after serving %d symbol(s).", server.symbol_count());
+
+        return 0;
+    }
 
     if (argc < 3)
     {
@@ -27,6 +92,50 @@ int main(int argc, const char** argv)
     const char* input_folder = argv[1];
     const char* output_folder = argv[2];
 
+    if (!g_settings.parse(argc, argv, 3))
+    {
+        // keep in sync with the option table of the README
+        g_log->error("MAIN", "Invalid arguments, usage: input_folder output_folder [--io posix|uring] [--precision f64|f32|bf16] "
+            "[--affinity none|cpu|numa] [--cache off|stat|hash] [--shard i/N] [--merge N] [--watch] [--normalize off|zscore|minmax] "
+            "[--normalize-window N] [--windows N] [--label-horizon K] [--barriers U,D] [--gaps off|ffill|zero|drop] [--interval N] "
+            "[--max-fill N] [--validate off|report|drop|strict] [--panel time|symbol] [--reference A,B] [--cross-windows N,M] "
+            "[--columns T,O,C,H,L,V] [--time-format auto|iso8601|s|ms|us|ns] [--time-unit s|ms|us|ns] [--input-precision f64|f32|bf16] "
+            "[--memory-budget SIZE] [--progress N] [--metrics-port N] [--metrics-file PATH], or: --stream stdin|unix:<path>");
+
+        return 1;
+    }
+
+    g_memory_budget.set_limit(g_settings.m_memory_budget);
+
+    if (g_settings.m_watch && g_settings.m_shard_count)
+    {
+        g_log->error("MAIN", "--watch can not be combined with --shard, new files are not in the frozen shard plan.");
+
+        return 1;
+    }
+
+    if (g_settings.m_merge_shards)
+    {
+        shard_plan plan(g_settings.m_merge_shards);
+        if (!plan.open(input_folder, output_folder, false))
+            return 1;
+
+        return plan.verify(output_folder, [&](const std::filesystem::path& input_file)
+        {
+            return symbol_processor::output_file(input_file, output_folder);
+        }) ? 0 : 1;
+    }
+
+    // created after parsing the arguments as the worker placement depends on them
+    g_log->info("MAIN", "Initiating thread pool.");
+    auto thread_pool_instance = std::make_unique<thread_pool>();
+    g_log->info("MAIN", "Vector kernels dispatched to %s.", cpu_dispatch::selected_level());
+
+    metrics_exporter metrics;
+    if ((g_settings.m_metrics_port || !g_settings.m_metrics_file.empty())
+        && !metrics.start(g_settings.m_metrics_port, g_settings.m_metrics_file))
+        return 1;
+
     if (!std::filesystem::exists(input_folder) || !std::filesystem::exists(output_folder))
     {
         g_log->error("MAIN", "Input and/or output folder do not exist.");
@@ -49,23 +158,208 @@ int main(int argc, const char** argv)
         return 1;
     }
 
-    std::chrono::time_point start_time = std::chrono::system_clock::now();
-    g_log->info("MAIN", "Starting parsing of files...");
-    for (const auto file : std::filesystem::directory_iterator(input_folder))
+    // loaded once before any worker runs, the workers only read them
+    if (!g_settings.m_reference_symbols.empty() && !reference_loader::load(input_folder, g_settings.m_reference_symbols, g_references))
+        return 1;
+
+    std::unique_ptr<result_cache> cache;
+    if (g_settings.m_cache_mode != cache_mode::off)
     {
-        g_thread_pool->push([=]()
+        // a shard only ever sees its own files, so it keeps its own manifest instead of racing the others on a shared one
+        const std::string manifest_suffix = g_settings.m_shard_count ? shard_plan::marker_file("", g_settings.m_shard_index, g_settings.m_shard_count).string() : "";
+        cache = std::make_unique<result_cache>(output_folder, g_settings.m_cache_mode, manifest_suffix);
+        g_log->info("MAIN", "Loaded result cache with %d entries.", cache->size());
+    }
+    std::atomic<size_t> skipped_files = 0;
+
+    // lets a later run that takes this folder's .bin files as input confirm how their prices were written
+    if (!binary_input::write_run_settings(output_folder))
+        g_log->warning("MAIN", "Failed to write %s to the output folder.", binary_input::run_settings_name);
+
+    // frozen by the first shard to start, the others and --merge read the same split back
+    shard_plan plan(g_settings.m_shard_count);
+    if (g_settings.m_shard_count && !plan.open(input_folder, output_folder, true))
+        return 1;
+
+    // the inputs of this process, listed at startup and again when the watcher lost events
+    const auto list_input_files = [&]()
+    {
+        std::vector<std::filesystem::path> files;
+        if (g_settings.m_shard_count)
         {
-            g_log->verbose("THREAD", "Processing file: %s", file.path().string().c_str());
+            for (const shard_plan::input_file& file : plan.files(g_settings.m_shard_index))
+                files.push_back(file.m_path);
+        }
+        else
+        {
+            // hidden files are run records like the cache manifest, never inputs (the watcher skips them as well)
+            for (const auto& file : std::filesystem::directory_iterator(input_folder))
+                if (!file.is_directory() && file.path().filename().string()[0] != '.')
+                    files.push_back(file.path());
+        }
 
-            if (!file.is_directory())
+        return files;
+    };
+
+    const std::vector<std::filesystem::path> input_files = list_input_files();
+    if (g_settings.m_shard_count)
+        g_log->info("MAIN", "Processing shard %d/%d with %d file(s).", g_settings.m_shard_index, g_settings.m_shard_count, input_files.size());
+
+    std::mutex finished_lock;
+    std::vector<std::string> finished_files;
+
+    // files that are queued but not started yet, so a burst of events for one file queues it once
+    std::mutex queued_lock;
+    std::set<std::filesystem::path> queued_files;
+    // files a worker is processing, events for them only mark them in rerun_files so two workers never write the same outputs
+    std::set<std::filesystem::path> running_files;
+    std::set<std::filesystem::path> rerun_files;
+
+    std::function<void(const std::filesystem::path&)> queue_file;
+    // input_bytes is the size registered with g_progress, whatever of it wasn't read still counts as done for the ETA
+    const auto run_file = [&](const std::filesystem::path& file, uint64_t input_bytes)
+    {
+        g_log->verbose("THREAD", "Processing file: %s", file.string().c_str());
+
+        result_cache::entry fingerprint;
+        if (cache && cache->is_current(file, symbol_processor::output_files(file, output_folder), fingerprint))
+        {
+            g_log->verbose("THREAD", "Skipping unchanged file: %s", file.string().c_str());
+            skipped_files++;
+        }
+        else
+        {
+            symbol_processor processor(file, output_folder);
+            if (!processor.run())
             {
-                symbol_processor processor(file, output_folder);
-                processor.start();
+                g_progress.file_finished(false, input_bytes);
+
+                return;
             }
+
+            // a streamed file lacks sidecars or repairs the batch path would add, a later run has to redo it
+            if (cache && !processor.partial())
+                cache->update(file, fingerprint);
+        }
+
+        if (g_settings.m_shard_count)
+        {
+            std::lock_guard<std::mutex> lock(finished_lock);
+            finished_files.push_back(file.filename().string());
+        }
+
+        g_progress.file_finished(true, input_bytes);
+    };
+    const auto process_file = [&](const std::filesystem::path& file, uint64_t input_bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queued_lock);
+            queued_files.erase(file);
+            running_files.insert(file);
+        }
+
+        run_file(file, input_bytes);
+
+        bool rerun;
+        {
+            std::lock_guard<std::mutex> lock(queued_lock);
+            running_files.erase(file);
+            rerun = rerun_files.erase(file);
+        }
+
+        // the file changed while it was processed, queued from the worker so the pool still counts it as busy
+        if (rerun)
+            queue_file(file);
+    };
+    queue_file = [&](const std::filesystem::path& file)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queued_lock);
+            if (running_files.count(file))
+            {
+                rerun_files.insert(file);
+
+                return;
+            }
+            if (!queued_files.insert(file).second)
+                return;
+        }
+
+        std::error_code code;
+        uint64_t size = std::filesystem::file_size(file, code);
+        if (code)
+            size = 0;
+        g_progress.add_input(size);
+
+        g_thread_pool->push([&process_file, file, size]()
+        {
+            process_file(file, size);
         });
+    };
+
+    std::unique_ptr<directory_watcher> watcher;
+    if (g_settings.m_watch)
+    {
+        // outputs written into the watched folder would trigger their own processing
+        std::error_code code;
+        const std::filesystem::path watched = std::filesystem::weakly_canonical(input_folder, code);
+        const std::filesystem::path written = std::filesystem::weakly_canonical(output_folder, code);
+        if (std::mismatch(watched.begin(), watched.end(), written.begin(), written.end()).first == watched.end())
+        {
+            g_log->error("MAIN", "--watch needs an output folder outside of the input folder.");
+
+            return 1;
+        }
+
+        // set up before the initial scan so files landing during it are not lost
+        watcher = std::make_unique<directory_watcher>(input_folder);
+        if (!watcher->is_valid())
+            return 1;
     }
 
-    while (thread_pool_instance->has_jobs())
+    std::chrono::time_point start_time = std::chrono::system_clock::now();
+    g_log->info("MAIN", "Starting parsing of files...");
+    g_progress.start(g_settings.m_progress_interval);
+    for (const std::filesystem::path& file : input_files)
+        queue_file(file);
+
+    if (watcher)
+    {
+        std::signal(SIGINT, on_stop_signal);
+        std::signal(SIGTERM, on_stop_signal);
+
+        g_log->info("MAIN", "Watching %s for new files, stop with SIGINT or SIGTERM.", input_folder);
+
+        std::vector<std::filesystem::path> ready_files;
+        bool overflowed = false;
+        while (s_running)
+        {
+            if (!watcher->poll(ready_files, overflowed, 1000))
+            {
+                g_log->error("MAIN", "Waiting for file events failed: %s", strerror(errno));
+
+                break;
+            }
+
+            // files closed while events were dropped are only found by listing the folder again, queue_file skips the
+            // ones already queued or running and --cache the ones already done
+            if (overflowed)
+                ready_files = list_input_files();
+
+            for (const std::filesystem::path& file : ready_files)
+                queue_file(file);
+            ready_files.clear();
+
+            // keep the manifest current so a restarted daemon doesn't redo the work
+            if (cache && !thread_pool_instance->has_jobs())
+                cache->save();
+        }
+
+        g_log->info("MAIN", "Stopping watch mode.");
+    }
+
+    // running jobs may still queue a rerun of their file
+    while (thread_pool_instance->has_jobs() || thread_pool_instance->active_jobs())
     {
         std::this_thread::sleep_for(500ms);
     }
@@ -80,8 +374,28 @@ int main(int argc, const char** argv)
 
     g_log->info("MAIN", "Waiting for all threads to exit...");
     thread_pool_instance->destroy();
+    // before the pool goes away, the last textfile holds the final counters
+    metrics.stop();
     thread_pool_instance.reset();
 
+    // only now every job has finished
+    g_progress.stop(std::filesystem::path(output_folder) / "throughput.json");
+    g_precision_report.log();
+    if (g_memory_budget.limit())
+        g_log->info("MAIN", "Peak reserved memory %zu MiB of a %zu MiB budget.", g_memory_budget.peak() >> 20, g_memory_budget.limit() >> 20);
+    if (cache)
+    {
+        g_log->info("MAIN", "Skipped %d unchanged file(s).", skipped_files.load());
+        cache->save();
+    }
+    if (g_settings.m_shard_count)
+    {
+        shard_plan::write_marker(output_folder, g_settings.m_shard_index, g_settings.m_shard_count, finished_files);
+        g_log->info("MAIN", "Shard %d/%d finished %d of %d file(s).", g_settings.m_shard_index, g_settings.m_shard_count, finished_files.size(), input_files.size());
+    }
+    if (g_settings.m_build_panel && !build_panel(output_folder))
+        return 1;
+
     g_log->info("MAIN", "Farewell!");
 
     return 0;
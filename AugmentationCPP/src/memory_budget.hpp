@@ -0,0 +1,112 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+#include "logger.hpp"
+
+namespace program
+{
+    /**
+     * @brief Global memory budget shared by the workers.
+     * A job reserves its estimated footprint before it loads its input and blocks until the reservation fits next to
+     * the ones of the running jobs. A job is always admitted when nothing else is reserved, so every job that fits
+     * the budget on its own eventually runs. Jobs that don't fit at all are expected to take the streaming path.
+     */
+    class memory_budget final
+    {
+        std::mutex m_lock;
+        std::condition_variable m_released;
+        // 0 = unlimited, reservations return immediately
+        size_t m_limit = 0;
+        size_t m_reserved = 0;
+        size_t m_peak = 0;
+
+    public:
+        class reservation final
+        {
+            memory_budget* m_budget;
+            size_t m_bytes;
+
+        public:
+            reservation(memory_budget& budget, size_t bytes) :
+                m_budget(&budget), m_bytes(bytes)
+            {
+                m_budget->acquire(m_bytes);
+            }
+
+            reservation(const reservation&) = delete;
+            reservation& operator=(const reservation&) = delete;
+
+            ~reservation()
+            {
+                m_budget->release(m_bytes);
+            }
+        };
+
+        void set_limit(size_t bytes)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_limit = bytes;
+        }
+
+        size_t limit()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            return m_limit;
+        }
+
+        /**
+         * @brief Whether a job of the given footprint can be admitted at all.
+         */
+        bool fits(size_t bytes)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            return !m_limit || bytes <= m_limit;
+        }
+
+        size_t reserved()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            return m_reserved;
+        }
+
+        // highest sum of reservations held at the same time
+        size_t peak()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            return m_peak;
+        }
+
+    private:
+        void acquire(size_t bytes)
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            if (m_limit && m_reserved && m_reserved + bytes > m_limit)
+            {
+                g_log->verbose("MEMORY", "Waiting for %zu MiB of the budget, %zu MiB are reserved.", bytes >> 20, m_reserved >> 20);
+                m_released.wait(lock, [&] { return !m_reserved || m_reserved + bytes <= m_limit; });
+            }
+
+            m_reserved += bytes;
+            m_peak = std::max(m_peak, m_reserved);
+        }
+
+        void release(size_t bytes)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_reserved -= bytes;
+            }
+
+            m_released.notify_all();
+        }
+    };
+
+    inline memory_budget g_memory_budget{};
+}
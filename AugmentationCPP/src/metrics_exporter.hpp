@@ -0,0 +1,314 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "logger.hpp"
+#include "memory_budget.hpp"
+#include "progress.hpp"
+#include "thread_pool.hpp"
+
+namespace program
+{
+    /**
+     * @brief Exposes the counters of the running batch or daemon in the Prometheus text format.
+     * Serves them on 127.0.0.1:port (any GET, the usual path is /metrics) and/or rewrites a textfile collector file
+     * every few seconds, for setups where node_exporter picks up the metrics instead of a direct scrape.
+     * Nothing is counted here: a scrape sums the per-thread slots of g_progress and reads the gauges of the thread
+     * pool and the memory budget, so the workers only ever pay for their own relaxed atomic adds.
+     */
+    class metrics_exporter final
+    {
+        static constexpr std::chrono::seconds textfile_interval{ 5 };
+
+        int m_listen_fd = -1;
+        std::filesystem::path m_file;
+        std::atomic<bool> m_running = false;
+        std::thread m_thread;
+
+    public:
+        metrics_exporter() = default;
+        metrics_exporter(const metrics_exporter&) = delete;
+        metrics_exporter& operator=(const metrics_exporter&) = delete;
+
+        ~metrics_exporter()
+        {
+            this->stop();
+        }
+
+        /**
+         * @param port tcp port on the loopback interface, 0 = no endpoint
+         * @param file textfile collector output, empty = no file
+         * @return false when the port can't be bound
+         */
+        bool start(uint16_t port, const std::filesystem::path& file)
+        {
+            if (port && !this->listen_tcp(port))
+                return false;
+
+            m_file = file;
+            m_running = true;
+            m_thread = std::thread(&metrics_exporter::run, this);
+
+            return true;
+        }
+
+        /**
+         * @brief Closes the endpoint and writes the textfile a last time, so it holds the final counters.
+         */
+        void stop()
+        {
+            if (!m_running.exchange(false))
+                return;
+
+            m_thread.join();
+            if (m_listen_fd >= 0)
+            {
+                close(m_listen_fd);
+                m_listen_fd = -1;
+            }
+            if (!m_file.empty())
+                this->write_file();
+        }
+
+        static std::string render()
+        {
+            const progress_reporter::totals current = g_progress.sum();
+            std::string text;
+            char buffer[256];
+
+            auto metric = [&](const char* name, const char* type, const char* help)
+            {
+                snprintf(buffer, sizeof(buffer), "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+                text += buffer;
+            };
+            auto sample = [&](const char* name, const char* labels, double value)
+            {
+                snprintf(buffer, sizeof(buffer), "%s%s %.15g\n", name, labels, value);
+                text += buffer;
+            };
+
+            if (g_thread_pool)
+            {
+                const size_t workers = g_thread_pool->worker_count();
+                const size_t active = g_thread_pool->active_jobs();
+
+                metric("augmentation_queue_depth", "gauge", "Jobs waiting for a worker.");
+                sample("augmentation_queue_depth", "", g_thread_pool->queued_jobs());
+                metric("augmentation_workers", "gauge", "Worker threads of the pool.");
+                sample("augmentation_workers", "", workers);
+                metric("augmentation_workers_busy", "gauge", "Workers running a job right now.");
+                sample("augmentation_workers_busy", "", active);
+                metric("augmentation_worker_utilization", "gauge", "Share of the workers running a job right now.");
+                sample("augmentation_worker_utilization", "", workers ? (double)active / workers : 0.0);
+            }
+            metric("augmentation_worker_busy_seconds_total", "counter", "Time the workers spent running jobs.");
+            sample("augmentation_worker_busy_seconds_total", "", current.m_busy_nanoseconds / 1e9);
+
+            metric("augmentation_files_queued_total", "counter", "Input files queued for processing.");
+            sample("augmentation_files_queued_total", "", g_progress.files_total());
+            metric("augmentation_files_total", "counter", "Input files finished, by result.");
+            sample("augmentation_files_total", "{result=\"done\"}", current.m_files_done);
+            sample("augmentation_files_total", "{result=\"failed\"}", current.m_files_failed);
+            metric("augmentation_errors_total", "counter", "Input files that failed to process.");
+            sample("augmentation_errors_total", "", current.m_files_failed);
+
+            metric("augmentation_stage_rows_total", "counter", "Rows passed through each pipeline stage.");
+            for (size_t s = 0; s < progress_reporter::stage_count; s++)
+                sample("augmentation_stage_rows_total", label("stage", progress_reporter::stage_names[s]).c_str(), current.m_stages[s].m_rows);
+            metric("augmentation_stage_bytes_total", "counter", "Bytes read or written by each pipeline stage.");
+            for (size_t s = 0; s < progress_reporter::stage_count; s++)
+                sample("augmentation_stage_bytes_total", label("stage", progress_reporter::stage_names[s]).c_str(), current.m_stages[s].m_bytes);
+
+            metric("augmentation_stage_duration_seconds", "histogram", "Duration of one pipeline stage of a file or block of rows.");
+            for (size_t s = 0; s < progress_reporter::stage_count; s++)
+            {
+                const progress_reporter::stage_totals& stage = current.m_stages[s];
+                const char* stage_name = progress_reporter::stage_names[s];
+
+                uint64_t cumulative = 0;
+                for (size_t b = 0; b < progress_reporter::bucket_count; b++)
+                {
+                    cumulative += stage.m_buckets[b];
+                    char bound[32] = "+Inf";
+                    if (b < progress_reporter::bucket_count - 1)
+                        snprintf(bound, sizeof(bound), "%g", progress_reporter::bucket_bounds[b]);
+
+                    snprintf(buffer, sizeof(buffer), "augmentation_stage_duration_seconds_bucket{stage=\"%s\",le=\"%s\"} %llu\n", stage_name, bound, (unsigned long long)cumulative);
+                    text += buffer;
+                }
+                sample("augmentation_stage_duration_seconds_sum", label("stage", stage_name).c_str(), stage.m_nanoseconds / 1e9);
+                sample("augmentation_stage_duration_seconds_count", label("stage", stage_name).c_str(), cumulative);
+            }
+
+            metric("augmentation_memory_reserved_bytes", "gauge", "Memory budget reserved by the running jobs.");
+            sample("augmentation_memory_reserved_bytes", "", g_memory_budget.reserved());
+            metric("augmentation_memory_reserved_peak_bytes", "gauge", "Highest memory budget reserved at the same time.");
+            sample("augmentation_memory_reserved_peak_bytes", "", g_memory_budget.peak());
+            metric("augmentation_memory_budget_bytes", "gauge", "Configured memory budget, 0 = unlimited.");
+            sample("augmentation_memory_budget_bytes", "", g_memory_budget.limit());
+
+            size_t resident = 0, resident_peak = 0;
+            if (read_memory_status(resident, resident_peak))
+            {
+                metric("process_resident_memory_bytes", "gauge", "Resident memory of the process.");
+                sample("process_resident_memory_bytes", "", resident);
+                metric("augmentation_resident_memory_peak_bytes", "gauge", "Highest resident memory of the process.");
+                sample("augmentation_resident_memory_peak_bytes", "", resident_peak);
+            }
+
+            return text;
+        }
+
+    private:
+        static std::string label(const char* name, const char* value)
+        {
+            return std::string("{") + name + "=\"" + value + "\"}";
+        }
+
+        // VmRSS and VmHWM of /proc/self/status, in bytes
+        static bool read_memory_status(size_t& resident, size_t& resident_peak)
+        {
+            std::ifstream status("/proc/self/status");
+            std::string line;
+            int found = 0;
+            while (std::getline(status, line))
+            {
+                size_t kilobytes = 0;
+                if (sscanf(line.c_str(), "VmRSS: %zu kB", &kilobytes) == 1)
+                {
+                    resident = kilobytes << 10;
+                    found++;
+                }
+                else if (sscanf(line.c_str(), "VmHWM: %zu kB", &kilobytes) == 1)
+                {
+                    resident_peak = kilobytes << 10;
+                    found++;
+                }
+            }
+
+            return found == 2;
+        }
+
+        bool listen_tcp(uint16_t port)
+        {
+            m_listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (m_listen_fd < 0)
+            {
+                g_log->error("METRICS", "Failed to create the metrics socket: %s", strerror(errno));
+
+                return false;
+            }
+
+            const int reuse = 1;
+            setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (bind(m_listen_fd, (const sockaddr*)&address, sizeof(address)) < 0 || listen(m_listen_fd, 8) < 0)
+            {
+                g_log->error("METRICS", "Failed to listen on 127.0.0.1:%u: %s", (unsigned)port, strerror(errno));
+                close(m_listen_fd);
+                m_listen_fd = -1;
+
+                return false;
+            }
+
+            g_log->info("METRICS", "Serving metrics on http://127.0.0.1:%u/metrics", (unsigned)port);
+
+            return true;
+        }
+
+        void run()
+        {
+            auto next_write = std::chrono::steady_clock::now();
+            while (m_running)
+            {
+                if (!m_file.empty() && std::chrono::steady_clock::now() >= next_write)
+                {
+                    this->write_file();
+                    next_write += textfile_interval;
+                }
+
+                // the timeout bounds how long stop() waits for the thread
+                pollfd listener{ m_listen_fd, POLLIN, 0 };
+                if (m_listen_fd < 0)
+                    poll(nullptr, 0, 500);
+                else if (poll(&listener, 1, 500) > 0)
+                    this->serve();
+            }
+        }
+
+        // answers a single request per connection, scrapes are rare and small
+        void serve()
+        {
+            const int client = accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0)
+                return;
+
+            // a stalled client must not block the next scrape
+            const timeval timeout{ 2, 0 };
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+            char request[1024];
+            const ssize_t received = recv(client, request, sizeof(request) - 1, 0);
+            std::string response;
+            if (received > 0 && !strncmp(request, "GET ", 4))
+            {
+                const std::string body = render();
+                response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            }
+            else
+            {
+                response = "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            }
+
+            for (size_t sent = 0; sent < response.size(); )
+            {
+                const ssize_t written = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (written <= 0)
+                    break;
+                sent += written;
+            }
+            close(client);
+        }
+
+        // written next to the target and renamed, so the collector never reads a partial file
+        void write_file() const
+        {
+            std::filesystem::path temporary = m_file;
+            temporary += ".tmp";
+            {
+                std::ofstream stream(temporary, std::ios::trunc);
+                stream << render();
+                if (!stream)
+                {
+                    g_log->warning("METRICS", "Failed to write %s.", temporary.c_str());
+
+                    return;
+                }
+            }
+
+            std::error_code code;
+            std::filesystem::rename(temporary, m_file, code);
+            if (code)
+                g_log->warning("METRICS", "Failed to replace %s: %s", m_file.c_str(), code.message().c_str());
+        }
+    };
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+
+namespace program
+{
+    struct numa_node
+    {
+        int m_id;
+        std::vector<int> m_cpus;
+    };
+
+    namespace numa_topology
+    {
+        // parses a kernel cpu list such as "0-7,16-23"
+        inline std::vector<int> parse_cpu_list(const std::string& list)
+        {
+            std::vector<int> cpus;
+
+            size_t pos = 0;
+            while (pos < list.size())
+            {
+                size_t end = list.find(',', pos);
+                if (end == std::string::npos)
+                    end = list.size();
+
+                const std::string range = list.substr(pos, end - pos);
+                if (const size_t dash = range.find('-'); dash != std::string::npos)
+                {
+                    for (int cpu = std::stoi(range.substr(0, dash)); cpu <= std::stoi(range.substr(dash + 1)); cpu++)
+                        cpus.push_back(cpu);
+                }
+                else if (!range.empty() && range != "\n")
+                {
+                    cpus.push_back(std::stoi(range));
+                }
+
+                pos = end + 1;
+            }
+
+            return cpus;
+        }
+
+        /**
+         * @brief Cpus the process may run on, a taskset or cgroup cpuset can exclude some of the online ones.
+         */
+        inline std::vector<int> allowed_cpus()
+        {
+            std::vector<int> cpus;
+
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0)
+            {
+                for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                    if (CPU_ISSET(cpu, &set))
+                        cpus.push_back(cpu);
+            }
+
+            if (cpus.empty())
+                for (int cpu = 0; cpu < (int)std::thread::hardware_concurrency(); cpu++)
+                    cpus.push_back(cpu);
+
+            return cpus;
+        }
+
+        /**
+         * @brief Reads the NUMA nodes and their cpus from sysfs, limited to the allowed cpus.
+         * Machines without NUMA information are reported as a single node owning every allowed cpu.
+         */
+        inline std::vector<numa_node> detect()
+        {
+            const std::vector<int> allowed = allowed_cpus();
+            std::vector<numa_node> nodes;
+
+            std::error_code error;
+            for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error))
+            {
+                const std::string name = entry.path().filename().string();
+                if (name.rfind("node", 0) != 0 || name.size() == 4 || !isdigit(name[4]))
+                    continue;
+
+                std::ifstream cpu_list(entry.path() / "cpulist");
+                std::string list;
+                if (!std::getline(cpu_list, list))
+                    continue;
+
+                numa_node node{ std::stoi(name.substr(4)), parse_cpu_list(list) };
+                node.m_cpus.erase(std::remove_if(node.m_cpus.begin(), node.m_cpus.end(), [&](int cpu)
+                {
+                    return !std::binary_search(allowed.begin(), allowed.end(), cpu);
+                }), node.m_cpus.end());
+                if (!node.m_cpus.empty())
+                    nodes.push_back(std::move(node));
+            }
+
+            if (nodes.empty())
+                nodes.push_back({ 0, allowed });
+
+            std::sort(nodes.begin(), nodes.end(), [](const numa_node& a, const numa_node& b) { return a.m_id < b.m_id; });
+
+            return nodes;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#include "candle.hpp"
+#include "augmentation/cpu_dispatch.hpp"
+
+namespace program
+{
+#pragma pack(push, 1)
+    // output row for output_precision::f32, 68 bytes instead of 128
+    struct candle_f32
+    {
+        uint64_t m_timestamp;
+        float m_values[candle::value_count];
+    };
+
+    // output row for output_precision::bf16, prices stay float32 and the features are stored as bfloat16
+    struct candle_bf16
+    {
+        uint64_t m_timestamp;
+        float m_prices[candle::price_count];
+        uint16_t m_features[candle::value_count - candle::price_count];
+    };
+#pragma pack(pop)
+
+    namespace precision
+    {
+        inline uint16_t to_bfloat16(float value)
+        {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+
+            // round to nearest even, NaNs are kept quiet instead of being rounded into infinity
+            const uint16_t rounded = (uint16_t)((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+            const uint16_t quiet_nan = (uint16_t)((bits >> 16) | 0x40);
+
+            return (bits & 0x7fffffff) > 0x7f800000 ? quiet_nan : rounded;
+        }
+
+        inline float from_bfloat16(uint16_t value)
+        {
+            uint32_t bits = (uint32_t)value << 16;
+
+            float result;
+            memcpy(&result, &bits, sizeof(result));
+
+            return result;
+        }
+
+        // the loops below have a fixed shape without branches so the compiler turns them into packed conversions
+
+        AUGMENTATION_KERNEL inline void convert(const double* __restrict src, float* __restrict dst, double* __restrict max_error, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                dst[i] = (float)src[i];
+
+            for (size_t i = 0; i < count; i++)
+                max_error[i] = std::max(max_error[i], std::fabs(src[i] - (double)dst[i]));
+        }
+
+        AUGMENTATION_KERNEL inline void convert(const double* __restrict src, uint16_t* __restrict dst, double* __restrict max_error, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                dst[i] = to_bfloat16((float)src[i]);
+
+            for (size_t i = 0; i < count; i++)
+                max_error[i] = std::max(max_error[i], std::fabs(src[i] - (double)from_bfloat16(dst[i])));
+        }
+
+        inline void convert_row(const candle& src, candle_f32& dst, double* max_error)
+        {
+            dst.m_timestamp = src.m_timestamp;
+            convert(src.values(), dst.m_values, max_error, candle::value_count);
+        }
+
+        inline void convert_row(const candle& src, candle_bf16& dst, double* max_error)
+        {
+            dst.m_timestamp = src.m_timestamp;
+            convert(src.values(), dst.m_prices, max_error, candle::price_count);
+            convert(src.values() + candle::price_count, dst.m_features, max_error + candle::price_count, candle::value_count - candle::price_count);
+        }
+    }
+
+    // collects the largest absolute conversion error per column over all processed files
+    class precision_report
+    {
+        mutable std::mutex m_lock;
+        double m_max_error[candle::value_count]{};
+        bool m_used = false;
+
+    public:
+        void merge(const double* max_error)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            for (size_t i = 0; i < candle::value_count; i++)
+                m_max_error[i] = std::max(m_max_error[i], max_error[i]);
+            m_used = true;
+        }
+
+        void log() const
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (!m_used) return;
+
+            for (size_t i = 0; i < candle::value_count; i++)
+                g_log->info("PRECISION", "Max conversion error of %-12s %g", candle::value_names[i], m_max_error[i]);
+        }
+    };
+
+    inline precision_report g_precision_report{};
+}
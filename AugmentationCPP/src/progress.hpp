@@ -0,0 +1,312 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "logger.hpp"
+
+namespace program
+{
+    enum class pipeline_stage
+    {
+        // parsing or mapping the input into candles
+        read,
+        // gap repair, indicators, normalization and sidecar features
+        compute,
+        // converting and writing the rows
+        write
+    };
+
+    using progress_clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Counts the rows, bytes and time of every pipeline stage and reports them while the batch runs.
+     * Every thread adds to its own cache line aligned slot, the reporter thread sums the slots when it prints,
+     * so the workers never contend on a shared counter. Stages report once per file or per block of rows.
+     */
+    class progress_reporter final
+    {
+    public:
+        static constexpr size_t stage_count = 3;
+        static constexpr const char* stage_names[stage_count] = { "read", "compute", "write" };
+
+        // upper bounds in seconds of the stage duration histogram, the last bucket is unbounded
+        static constexpr size_t bucket_count = 9;
+        static constexpr double bucket_bounds[bucket_count - 1] = { 0.001, 0.005, 0.025, 0.1, 0.5, 2.5, 10.0, 60.0 };
+
+        struct stage_totals
+        {
+            uint64_t m_rows = 0;
+            uint64_t m_bytes = 0;
+            uint64_t m_nanoseconds = 0;
+            // durations per bucket, not cumulative
+            std::array<uint64_t, bucket_count> m_buckets{};
+        };
+
+        struct totals
+        {
+            std::array<stage_totals, stage_count> m_stages{};
+            uint64_t m_files_done = 0;
+            uint64_t m_files_failed = 0;
+            // time the workers spent running jobs
+            uint64_t m_busy_nanoseconds = 0;
+            uint64_t m_unread_bytes = 0;
+        };
+
+    private:
+        struct alignas(64) thread_slot
+        {
+            std::atomic<uint64_t> m_rows[stage_count]{};
+            std::atomic<uint64_t> m_bytes[stage_count]{};
+            std::atomic<uint64_t> m_nanoseconds[stage_count]{};
+            std::atomic<uint64_t> m_buckets[stage_count][bucket_count]{};
+            std::atomic<uint64_t> m_files_done{};
+            std::atomic<uint64_t> m_files_failed{};
+            std::atomic<uint64_t> m_busy_nanoseconds{};
+            // input bytes of finished files that the read stage never counted (cache hits, failures before or during the read)
+            std::atomic<uint64_t> m_unread_bytes{};
+            // read stage bytes at the last file_finished() of the owning thread
+            uint64_t m_read_mark = 0;
+        };
+
+        // threads beyond max_threads share the last slot, the counters stay correct as every update is atomic
+        static constexpr size_t max_threads = 512;
+        std::array<thread_slot, max_threads> m_slots;
+        std::atomic<size_t> m_next_slot = 0;
+
+        std::atomic<uint64_t> m_files_total = 0;
+        std::atomic<uint64_t> m_bytes_total = 0;
+
+        progress_clock::time_point m_start = progress_clock::now();
+        std::thread m_thread;
+        std::mutex m_lock;
+        std::condition_variable m_stop_condition;
+        bool m_stopping = false;
+
+    public:
+        /**
+         * @brief Registers a queued input, its size is the base of the ETA.
+         */
+        void add_input(uint64_t bytes)
+        {
+            m_files_total.fetch_add(1, std::memory_order_relaxed);
+            m_bytes_total.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Adds the work of one stage that started at begin, one observation of the duration histogram.
+         */
+        void add(pipeline_stage stage, uint64_t rows, uint64_t bytes, progress_clock::time_point begin)
+        {
+            this->add(stage, rows, bytes, progress_clock::now() - begin);
+        }
+
+        /**
+         * @brief Adds the work of one stage that took elapsed in total, for stages whose time is spread over several parts.
+         */
+        void add(pipeline_stage stage, uint64_t rows, uint64_t bytes, progress_clock::duration elapsed)
+        {
+            const uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+            thread_slot& slot = this->slot();
+            slot.m_rows[(size_t)stage].fetch_add(rows, std::memory_order_relaxed);
+            slot.m_bytes[(size_t)stage].fetch_add(bytes, std::memory_order_relaxed);
+            slot.m_nanoseconds[(size_t)stage].fetch_add(nanoseconds, std::memory_order_relaxed);
+
+            size_t bucket = 0;
+            while (bucket < bucket_count - 1 && nanoseconds > bucket_bounds[bucket] * 1e9)
+                bucket++;
+            slot.m_buckets[(size_t)stage][bucket].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // bytes that belong to a stage whose durations were already observed
+        void add_bytes(pipeline_stage stage, uint64_t bytes)
+        {
+            this->slot().m_bytes[(size_t)stage].fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        // time a worker spent running one job, the base of the worker utilization
+        void add_busy(uint64_t nanoseconds)
+        {
+            this->slot().m_busy_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+        }
+
+        /**
+         * @param input_bytes size the file was registered with in add_input()
+         * A file runs on one worker from start to finish, so the read bytes of this slot since its last finished file
+         * belong to it, the rest of its size counts as consumed for the ETA without touching the read rate.
+         */
+        void file_finished(bool success, uint64_t input_bytes)
+        {
+            thread_slot& slot = this->slot();
+            (success ? slot.m_files_done : slot.m_files_failed).fetch_add(1, std::memory_order_relaxed);
+
+            const uint64_t read_bytes = slot.m_bytes[(size_t)pipeline_stage::read].load(std::memory_order_relaxed);
+            const uint64_t file_read_bytes = read_bytes - std::min(slot.m_read_mark, read_bytes);
+            slot.m_read_mark = read_bytes;
+            if (file_read_bytes < input_bytes)
+                slot.m_unread_bytes.fetch_add(input_bytes - file_read_bytes, std::memory_order_relaxed);
+        }
+
+        totals sum() const
+        {
+            totals result;
+            for (const thread_slot& slot : m_slots)
+            {
+                for (size_t s = 0; s < stage_count; s++)
+                {
+                    result.m_stages[s].m_rows += slot.m_rows[s].load(std::memory_order_relaxed);
+                    result.m_stages[s].m_bytes += slot.m_bytes[s].load(std::memory_order_relaxed);
+                    result.m_stages[s].m_nanoseconds += slot.m_nanoseconds[s].load(std::memory_order_relaxed);
+                    for (size_t b = 0; b < bucket_count; b++)
+                        result.m_stages[s].m_buckets[b] += slot.m_buckets[s][b].load(std::memory_order_relaxed);
+                }
+                result.m_files_done += slot.m_files_done.load(std::memory_order_relaxed);
+                result.m_files_failed += slot.m_files_failed.load(std::memory_order_relaxed);
+                result.m_busy_nanoseconds += slot.m_busy_nanoseconds.load(std::memory_order_relaxed);
+                result.m_unread_bytes += slot.m_unread_bytes.load(std::memory_order_relaxed);
+            }
+
+            return result;
+        }
+
+        /**
+         * @brief Starts logging a status line every interval_seconds, 0 only resets the clock for the summary.
+         */
+        void start(size_t interval_seconds)
+        {
+            m_start = progress_clock::now();
+            if (!interval_seconds)
+                return;
+
+            m_thread = std::thread([this, interval_seconds]()
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                while (!m_stop_condition.wait_for(lock, std::chrono::seconds(interval_seconds), [this] { return m_stopping; }))
+                    g_log->info("PROGRESS", "%s", this->status_line().c_str());
+            });
+        }
+
+        /**
+         * @brief Stops the status line and logs the throughput of the whole run and writes it to summary_file as json.
+         */
+        void stop(const std::filesystem::path& summary_file)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_stopping = true;
+            }
+            m_stop_condition.notify_all();
+            if (m_thread.joinable())
+                m_thread.join();
+
+            const totals current = this->sum();
+            const double seconds = this->elapsed_seconds();
+            g_log->info("PROGRESS", "Finished %llu file(s), %llu failed: %s", (unsigned long long)current.m_files_done, (unsigned long long)current.m_files_failed, this->rates(current, seconds).c_str());
+
+            std::ofstream summary_stream(summary_file, std::ios::trunc);
+            summary_stream << this->to_json(current, seconds);
+        }
+
+        uint64_t files_total() const
+        {
+            return m_files_total.load(std::memory_order_relaxed);
+        }
+
+        std::string status_line() const
+        {
+            const totals current = this->sum();
+            const double seconds = this->elapsed_seconds();
+
+            // remaining input at the read rate so far, skipped and failed files are consumed without being read
+            const uint64_t bytes_total = m_bytes_total.load(std::memory_order_relaxed);
+            const uint64_t bytes_read = current.m_stages[(size_t)pipeline_stage::read].m_bytes;
+            const uint64_t bytes_consumed = bytes_read + current.m_unread_bytes;
+            const double read_rate = seconds > 0.0 ? bytes_read / seconds : 0.0;
+            char eta[32] = "?";
+            if (read_rate > 0.0 && bytes_total >= bytes_consumed)
+            {
+                const uint64_t remaining = (uint64_t)((bytes_total - bytes_consumed) / read_rate);
+                snprintf(eta, sizeof(eta), "%llumin %llusecs", (unsigned long long)remaining / 60, (unsigned long long)remaining % 60);
+            }
+
+            char line[128];
+            snprintf(line, sizeof(line), "Files %llu/%llu, ETA %s, ",
+                (unsigned long long)(current.m_files_done + current.m_files_failed), (unsigned long long)m_files_total.load(std::memory_order_relaxed), eta);
+
+            return line + this->rates(current, seconds);
+        }
+
+    private:
+        thread_slot& slot()
+        {
+            thread_local thread_slot* s_slot = nullptr;
+            if (!s_slot)
+                s_slot = &m_slots[std::min(m_next_slot.fetch_add(1, std::memory_order_relaxed), max_threads - 1)];
+
+            return *s_slot;
+        }
+
+        double elapsed_seconds() const
+        {
+            return std::chrono::duration<double>(progress_clock::now() - m_start).count();
+        }
+
+        // overall rows per second of the wall clock, then the rate of every stage over the time spent in it
+        static std::string rates(const totals& current, double seconds)
+        {
+            const uint64_t rows_done = current.m_stages[(size_t)pipeline_stage::write].m_rows;
+            char buffer[160];
+            snprintf(buffer, sizeof(buffer), "%.2fM rows (%.2fM rows/s)", rows_done / 1e6, seconds > 0.0 ? rows_done / seconds / 1e6 : 0.0);
+
+            std::string line = buffer;
+            for (size_t s = 0; s < stage_count; s++)
+            {
+                const stage_totals& stage = current.m_stages[s];
+                const double busy = stage.m_nanoseconds / 1e9;
+                snprintf(buffer, sizeof(buffer), ", %s %.2fM rows/s", stage_names[s], busy > 0.0 ? stage.m_rows / busy / 1e6 : 0.0);
+                line += buffer;
+
+                if (stage.m_bytes)
+                {
+                    snprintf(buffer, sizeof(buffer), " %.1f MiB/s", busy > 0.0 ? stage.m_bytes / busy / 1048576.0 : 0.0);
+                    line += buffer;
+                }
+            }
+
+            return line;
+        }
+
+        static std::string to_json(const totals& current, double seconds)
+        {
+            char buffer[256];
+            snprintf(buffer, sizeof(buffer), "{\"seconds\":%.3f,\"files_done\":%llu,\"files_failed\":%llu,\"stages\":{",
+                seconds, (unsigned long long)current.m_files_done, (unsigned long long)current.m_files_failed);
+
+            std::string json = buffer;
+            for (size_t s = 0; s < stage_count; s++)
+            {
+                const stage_totals& stage = current.m_stages[s];
+                const double busy = stage.m_nanoseconds / 1e9;
+                snprintf(buffer, sizeof(buffer), "%s\"%s\":{\"rows\":%llu,\"bytes\":%llu,\"busy_seconds\":%.3f,\"rows_per_busy_second\":%.1f,\"bytes_per_busy_second\":%.1f}",
+                    s ? "," : "", stage_names[s], (unsigned long long)stage.m_rows, (unsigned long long)stage.m_bytes, busy,
+                    busy > 0.0 ? stage.m_rows / busy : 0.0, busy > 0.0 ? stage.m_bytes / busy : 0.0);
+                json += buffer;
+            }
+            json += "}}\n";
+
+            return json;
+        }
+    };
+
+    inline progress_reporter g_progress{};
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "augmentation/cross_asset.hpp"
+#include "binary_input.hpp"
+#include "csv_projection.hpp"
+#include "logger.hpp"
+#include "settings.hpp"
+
+namespace program
+{
+    // reference series for the cross asset features, filled before the workers start and only read afterwards
+    inline std::vector<reference_series> g_references;
+
+    class reference_loader final
+    {
+    public:
+        /**
+         * @brief Loads the close prices of every named symbol from the file with that stem in the input folder.
+         */
+        static bool load(const std::filesystem::path& input_folder, const std::vector<std::string>& names, std::vector<reference_series>& references)
+        {
+            for (const std::string& name : names)
+            {
+                std::filesystem::path file;
+                for (const auto& entry : std::filesystem::directory_iterator(input_folder))
+                    if (entry.path().stem() == name)
+                        file = entry.path();
+
+                if (file.empty())
+                {
+                    g_log->error("REFERENCE", "No input file for reference symbol %s.", name.c_str());
+
+                    return false;
+                }
+
+                std::vector<uint64_t> timestamps;
+                std::vector<double> close;
+                // the features look references up by timestamp, rows that go back in time are skipped
+                const auto add_row = [&](uint64_t timestamp, double close_price)
+                {
+                    if (!timestamps.empty() && timestamp <= timestamps.back())
+                        return;
+
+                    timestamps.push_back(timestamp);
+                    close.push_back(close_price);
+                };
+
+                // normalized like the symbol timestamps they are matched against
+                timestamp_parser parser(g_settings.m_timestamp_format, g_settings.m_time_unit);
+                const input_format format = binary_input::detect(file);
+                std::string warning, error;
+                try
+                {
+                    if (format == input_format::csv)
+                    {
+                        projected_csv_reader<2> input_stream(file.string().c_str());
+                        input_stream.read_header({ g_settings.m_input_columns[0], g_settings.m_input_columns[2] });
+
+                        std::array<char*, 2> row;
+                        while (input_stream.read_row(row))
+                        {
+                            const uint64_t timestamp = input_stream.parse(row[0], parser);
+                            double close_price;
+                            input_stream.parse(row[1], close_price);
+                            add_row(timestamp, close_price);
+                        }
+                    }
+                    else if (format == input_format::candle_rows && !binary_input::check_run_settings(file, warning, error))
+                    {
+                        throw std::runtime_error(error);
+                    }
+                    else
+                    {
+                        if (!warning.empty())
+                            g_log->warning("REFERENCE", "Reading the prices of %s as they are: %s.", file.c_str(), warning.c_str());
+
+                        // the prices come as open, close, high, low and volume, outputs of a previous run are in --time-unit already
+                        const bool read = binary_input::read(file, format, g_settings.m_input_precision, [&](uint64_t timestamp, const double* values)
+                        {
+                            add_row(format == input_format::ohlcv_columns ? parser.normalize(timestamp) : timestamp, values[1]);
+                        }, error);
+                        if (!read)
+                            throw std::runtime_error(error);
+                    }
+                }
+                catch (const std::exception& e)
+                {
+                    g_log->error("REFERENCE", "Failure while reading %s:\n%s", file.c_str(), e.what());
+
+                    return false;
+                }
+
+                g_log->info("REFERENCE", "Loaded %d candles of reference %s.", timestamps.size(), name.c_str());
+                references.emplace_back(name, std::move(timestamps), close);
+            }
+
+            return true;
+        }
+    };
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hash.hpp"
+#include "logger.hpp"
+#include "reference_loader.hpp"
+#include "settings.hpp"
+
+namespace program
+{
+    /**
+     * @brief Manifest of already processed inputs stored next to the outputs.
+     * An input is skipped when its fingerprint and the configuration hash match the manifest and its output still exists.
+     */
+    class result_cache final
+    {
+    public:
+        struct entry
+        {
+            uint64_t m_size = 0;
+            int64_t m_mtime = 0;
+            uint64_t m_content_hash = 0;
+            uint64_t m_config_hash = 0;
+        };
+
+        static constexpr const char* manifest_name = ".augmentation_cache";
+
+    private:
+        std::filesystem::path m_manifest_path;
+        cache_mode m_mode;
+        uint64_t m_config_hash;
+
+        mutable std::mutex m_lock;
+        std::unordered_map<std::string, entry> m_entries;
+        bool m_dirty = false;
+
+    public:
+        /**
+         * @param manifest_suffix appended to the manifest name, shards sharing an output folder each keep their own manifest
+         */
+        result_cache(const std::filesystem::path& out_dir, cache_mode mode, const std::string& manifest_suffix = "") :
+            m_manifest_path(out_dir / (manifest_name + manifest_suffix)), m_mode(mode)
+        {
+            // the binary itself is part of the key so a rebuild never reuses stale outputs
+            m_config_hash = hash::string(g_settings.output_fingerprint(), hash::file("/proc/self/exe"));
+            // so are the loaded reference series, every .cross output depends on their timestamps and closes
+            for (const reference_series& reference : g_references)
+            {
+                m_config_hash = hash::string(reference.m_name, m_config_hash);
+                m_config_hash = hash::bytes(reference.m_timestamps.data(), reference.m_timestamps.size() * sizeof(uint64_t), m_config_hash);
+                m_config_hash = hash::bytes(reference.m_log_returns.data(), reference.m_log_returns.size() * sizeof(double), m_config_hash);
+            }
+
+            this->load();
+        }
+
+        /**
+         * @brief Computes the fingerprint of an input and compares it with the manifest.
+         * @param output_files the output and the enabled sidecars, the input is only current when all of them exist
+         * @param fingerprint receives the current fingerprint, pass it to update() once the file was processed
+         */
+        bool is_current(const std::filesystem::path& input_file, const std::vector<std::filesystem::path>& output_files, entry& fingerprint)
+        {
+            std::error_code error;
+            fingerprint.m_size = std::filesystem::file_size(input_file, error);
+            if (error) return false;
+            fingerprint.m_mtime = std::filesystem::last_write_time(input_file, error).time_since_epoch().count();
+            if (error) return false;
+            fingerprint.m_config_hash = m_config_hash;
+
+            entry cached;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+
+                auto it = m_entries.find(input_file.filename().string());
+                if (it == m_entries.end())
+                    return false;
+
+                cached = it->second;
+            }
+
+            if (cached.m_config_hash != m_config_hash || cached.m_size != fingerprint.m_size)
+                return false;
+
+            for (const std::filesystem::path& output_file : output_files)
+                if (!std::filesystem::exists(output_file, error))
+                    return false;
+
+            // an unchanged size and mtime is enough in both modes, so reruns over unchanged inputs never read them
+            if (cached.m_mtime == fingerprint.m_mtime)
+                return true;
+            if (m_mode == cache_mode::stat)
+                return false;
+
+            // a touched but otherwise identical file is still current, only then we pay for reading it
+            fingerprint.m_content_hash = hash::file(input_file);
+            if (cached.m_content_hash != fingerprint.m_content_hash)
+                return false;
+
+            // the new mtime lets the next run skip the file without reading it
+            this->update(input_file, fingerprint);
+
+            return true;
+        }
+
+        void update(const std::filesystem::path& input_file, entry fingerprint)
+        {
+            if (m_mode == cache_mode::hash && !fingerprint.m_content_hash)
+                fingerprint.m_content_hash = hash::file(input_file);
+
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            m_entries[input_file.filename().string()] = fingerprint;
+            m_dirty = true;
+        }
+
+        /**
+         * @brief Writes the manifest to a temporary file and renames it over the old one.
+         */
+        bool save()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (!m_dirty) return true;
+
+            std::filesystem::path tmp_path = m_manifest_path;
+            tmp_path += ".tmp";
+
+            {
+                std::ofstream output_stream(tmp_path, std::ios::trunc);
+                for (const auto& [name, cached] : m_entries)
+                    output_stream << cached.m_size << ' ' << cached.m_mtime << ' ' << cached.m_content_hash << ' ' << cached.m_config_hash << ' ' << name << '\n';
+
+                if (!output_stream)
+                {
+                    g_log->error("CACHE", "Failed to write %s.", tmp_path.c_str());
+
+                    return false;
+                }
+            }
+
+            std::error_code error;
+            std::filesystem::rename(tmp_path, m_manifest_path, error);
+            m_dirty = false;
+
+            return !error;
+        }
+
+        size_t size() const
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            return m_entries.size();
+        }
+
+    private:
+        void load()
+        {
+            std::ifstream input_stream(m_manifest_path);
+
+            std::string line;
+            while (std::getline(input_stream, line))
+            {
+                std::istringstream fields(line);
+
+                entry cached;
+                std::string name;
+                if (fields >> cached.m_size >> cached.m_mtime >> cached.m_content_hash >> cached.m_config_hash && std::getline(fields >> std::ws, name))
+                    m_entries[name] = cached;
+            }
+        }
+    };
+}
@@ -0,0 +1,545 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "timestamp_parser.hpp"
+#include "augmentation/indicators.hpp"
+#include "augmentation/labels.hpp"
+#include "augmentation/normalization.hpp"
+#include "augmentation/panel_builder.hpp"
+
+namespace program
+{
+    enum class io_backend
+    {
+        posix,
+        uring
+    };
+
+    enum class output_precision
+    {
+        // raw candle structs
+        f64,
+        // every column as float32
+        f32,
+        // prices as float32, indicator features as bfloat16
+        bf16
+    };
+
+    enum class worker_affinity
+    {
+        // threads are scheduled freely by the os
+        none,
+        // every worker is pinned to its own cpu
+        cpu,
+        // workers are pinned to the cpus of a NUMA node and take files from that node's queue first
+        numa
+    };
+
+    enum class cache_mode
+    {
+        off,
+        // inputs count as unchanged when their size and modification time match the manifest
+        stat,
+        // inputs count as unchanged when the hash of their content matches the manifest
+        hash
+    };
+
+    enum class gap_policy
+    {
+        // rows are used as they are
+        off,
+        // missing candles repeat the previous candle
+        ffill,
+        // missing candles are flat bars at the previous close with 0 volume
+        zero_volume,
+        // duplicated and out of order rows are repaired, gaps stay
+        drop
+    };
+
+    enum class validation_mode
+    {
+        off,
+        // rows are checked and counted, the statistics are written next to the output
+        report,
+        // like report, invalid rows are left out
+        drop,
+        // like report, files with invalid rows fail
+        strict
+    };
+
+    struct settings
+    {
+        // backend used to load input files and write output files
+        io_backend m_io_backend = io_backend::posix;
+        // precision of the value columns in the binary output
+        output_precision m_output_precision = output_precision::f64;
+        // row format of .bin inputs, the outputs of a previous run
+        output_precision m_input_precision = output_precision::f64;
+        // placement of the thread pool workers
+        worker_affinity m_worker_affinity = worker_affinity::none;
+        // skipping of inputs that were already processed with the same configuration
+        cache_mode m_cache_mode = cache_mode::off;
+
+        // --shard i/N, this process only handles shard m_shard_index of m_shard_count (0 = no sharding)
+        size_t m_shard_index = 0;
+        size_t m_shard_count = 0;
+        // --merge N, only verify that all N shards produced their outputs
+        size_t m_merge_shards = 0;
+
+        // --memory-budget SIZE, bytes the jobs running at the same time may reserve together (0 = unlimited)
+        size_t m_memory_budget = 0;
+
+        // --progress N, seconds between status lines (0 = only the summary at the end)
+        size_t m_progress_interval = 10;
+
+        // --metrics-port N, Prometheus endpoint on 127.0.0.1 (0 = off)
+        uint16_t m_metrics_port = 0;
+        // --metrics-file PATH, Prometheus textfile collector output rewritten while running (empty = off)
+        std::string m_metrics_file;
+
+        // keep running and process files as soon as they land in the input folder
+        bool m_watch = false;
+        // --stream stdin|unix:<path>, serve indicators for candle streams instead of processing folders
+        std::string m_stream_source;
+
+        indicator_config m_indicators;
+
+        // --columns, header names of the timestamp, open, close, high, low and volume columns of the inputs
+        std::array<std::string, 6> m_input_columns{ "event_time", "open", "close", "high", "low", "volume" };
+        // --time-format, layout of the timestamp column, detected per file from its first row by default
+        timestamp_format m_timestamp_format = timestamp_format::detect;
+        // --time-unit, unit every timestamp is converted to
+        time_unit m_time_unit = time_unit::ms;
+
+        // rolling normalization of the value columns after the indicators were calculated
+        normalization_mode m_normalization = normalization_mode::none;
+        size_t m_normalization_window = 256;
+
+        // invariant checks and column statistics while parsing
+        validation_mode m_validation = validation_mode::off;
+
+        // repair of the time index between reading and the indicators
+        gap_policy m_gap_policy = gap_policy::off;
+        // --interval N, expected timestamp spacing (0 = most common spacing of the file)
+        uint64_t m_gap_interval = 0;
+        // --max-fill N, largest gap in rows that --gaps ffill|zero fills, larger ones stay open
+        size_t m_max_fill = 10080;
+
+        // --label-horizon K and --barriers U,D, look-ahead targets written next to every output
+        label_config m_labels;
+
+        // --reference A,B and --cross-windows N,M, rolling statistics of every symbol against the reference symbols
+        std::vector<std::string> m_reference_symbols;
+        std::vector<size_t> m_cross_windows{ 60 };
+
+        // --panel time|symbol, align all outputs on one timestamp index after processing
+        bool m_build_panel = false;
+        panel_layout m_panel_layout = panel_layout::time_major;
+
+        // --windows N, writes an index of the valid N candle training windows next to every output (0 = off)
+        size_t m_export_window = 0;
+
+        /**
+         * @brief Parses the optional "--flag value" arguments that follow the input and output folders.
+         * @return false when an unknown flag or an invalid value was passed
+         */
+        bool parse(int argc, const char** argv, int first)
+        {
+            for (int i = first; i < argc; i++)
+            {
+                const char* flag = argv[i];
+                const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+                if (!strcmp(flag, "--io") && value)
+                {
+                    if (!strcmp(value, "posix"))
+                        m_io_backend = io_backend::posix;
+                    else if (!strcmp(value, "uring"))
+                        m_io_backend = io_backend::uring;
+                    else
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--precision") && value)
+                {
+                    if (!strcmp(value, "f64"))
+                        m_output_precision = output_precision::f64;
+                    else if (!strcmp(value, "f32"))
+                        m_output_precision = output_precision::f32;
+                    else if (!strcmp(value, "bf16"))
+                        m_output_precision = output_precision::bf16;
+                    else
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--input-precision") && value)
+                {
+                    if (!strcmp(value, "f64"))
+                        m_input_precision = output_precision::f64;
+                    else if (!strcmp(value, "f32"))
+                        m_input_precision = output_precision::f32;
+                    else if (!strcmp(value, "bf16"))
+                        m_input_precision = output_precision::bf16;
+                    else
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--cache") && value)
+                {
+                    if (!strcmp(value, "off"))
+                        m_cache_mode = cache_mode::off;
+                    else if (!strcmp(value, "stat"))
+                        m_cache_mode = cache_mode::stat;
+                    else if (!strcmp(value, "hash"))
+                        m_cache_mode = cache_mode::hash;
+                    else
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--shard") && value)
+                {
+                    const char* rest;
+                    if (!parse_count(value, m_shard_index, max_shards, &rest) || *rest != '/'
+                        || !parse_count(rest + 1, m_shard_count, max_shards) || m_shard_index >= m_shard_count)
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--merge") && value)
+                {
+                    if (!parse_count(value, m_merge_shards, max_shards) || !m_merge_shards)
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--stream") && value)
+                {
+                    m_stream_source = value;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--watch"))
+                {
+                    m_watch = true;
+                }
+                else if (!strcmp(flag, "--normalize") && value)
+                {
+                    if (!strcmp(value, "off"))
+                        m_normalization = normalization_mode::none;
+                    else if (!strcmp(value, "zscore"))
+                        m_normalization = normalization_mode::zscore;
+                    else if (!strcmp(value, "minmax"))
+                        m_normalization = normalization_mode::minmax;
+                    else
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--normalize-window") && value)
+                {
+                    if (!parse_count(value, m_normalization_window, max_rows) || !m_normalization_window)
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--windows") && value)
+                {
+                    if (!parse_count(value, m_export_window, max_rows) || !m_export_window)
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--label-horizon") && value)
+                {
+                    if (!parse_count(value, m_labels.m_horizon, max_rows) || !m_labels.m_horizon)
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--barriers") && value)
+                {
+                    if (sscanf(value, "%lf,%lf", &m_labels.m_upper_barrier, &m_labels.m_lower_barrier) != 2 || !m_labels.has_barriers() || m_labels.m_lower_barrier >= 1.0)
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--validate") && value)
+                {
+                    if (!strcmp(value, "off"))
+                        m_validation = validation_mode::off;
+                    else if (!strcmp(value, "report"))
+                        m_validation = validation_mode::report;
+                    else if (!strcmp(value, "drop"))
+                        m_validation = validation_mode::drop;
+                    else if (!strcmp(value, "strict"))
+                        m_validation = validation_mode::strict;
+                    else
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--gaps") && value)
+                {
+                    if (!strcmp(value, "off"))
+                        m_gap_policy = gap_policy::off;
+                    else if (!strcmp(value, "ffill"))
+                        m_gap_policy = gap_policy::ffill;
+                    else if (!strcmp(value, "zero"))
+                        m_gap_policy = gap_policy::zero_volume;
+                    else if (!strcmp(value, "drop"))
+                        m_gap_policy = gap_policy::drop;
+                    else
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--interval") && value)
+                {
+                    // kept below INT64_MAX, it is added to and subtracted from timestamps
+                    if (!parse_count(value, m_gap_interval, INT64_MAX))
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--max-fill") && value)
+                {
+                    if (!parse_count(value, m_max_fill, max_rows))
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--panel") && value)
+                {
+                    if (!strcmp(value, "time"))
+                        m_panel_layout = panel_layout::time_major;
+                    else if (!strcmp(value, "symbol"))
+                        m_panel_layout = panel_layout::symbol_major;
+                    else
+                        return false;
+                    m_build_panel = true;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--reference") && value)
+                {
+                    m_reference_symbols = split(value);
+                    if (m_reference_symbols.empty())
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--cross-windows") && value)
+                {
+                    m_cross_windows.clear();
+                    for (const std::string& window : split(value))
+                    {
+                        size_t parsed;
+                        if (!parse_count(window.c_str(), parsed, max_rows) || parsed < 2)
+                            return false;
+
+                        m_cross_windows.push_back(parsed);
+                    }
+                    if (m_cross_windows.empty())
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--columns") && value)
+                {
+                    const std::vector<std::string> names = split(value);
+                    if (names.size() != m_input_columns.size())
+                        return false;
+                    std::copy(names.begin(), names.end(), m_input_columns.begin());
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--memory-budget") && value)
+                {
+                    // plain bytes or with a K, M or G suffix
+                    uint64_t amount;
+                    const char* unit;
+                    if (!parse_count(value, amount, UINT64_MAX, &unit) || !amount)
+                        return false;
+
+                    const char* units = "KMG";
+                    const char* suffix = *unit ? strchr(units, toupper((unsigned char)*unit)) : nullptr;
+                    if (*unit && (!suffix || unit[1]))
+                        return false;
+
+                    const int shift = suffix ? 10 * (int)(suffix - units + 1) : 0;
+                    if (amount > (uint64_t)SIZE_MAX >> shift)
+                        return false;
+                    m_memory_budget = (size_t)amount << shift;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--progress") && value)
+                {
+                    if (!parse_count(value, m_progress_interval, 86400))
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--metrics-port") && value)
+                {
+                    if (!parse_count(value, m_metrics_port))
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--metrics-file") && value)
+                {
+                    m_metrics_file = value;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--time-format") && value)
+                {
+                    static constexpr timestamp_format formats[] = { timestamp_format::detect, timestamp_format::iso8601, timestamp_format::epoch_s,
+                        timestamp_format::epoch_ms, timestamp_format::epoch_us, timestamp_format::epoch_ns };
+
+                    const timestamp_format* format = std::find_if(std::begin(formats), std::end(formats), [&](timestamp_format f) { return !strcmp(value, timestamp_parser::to_string(f)); });
+                    if (format == std::end(formats))
+                        return false;
+                    m_timestamp_format = *format;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--time-unit") && value)
+                {
+                    if (!strcmp(value, "s"))
+                        m_time_unit = time_unit::s;
+                    else if (!strcmp(value, "ms"))
+                        m_time_unit = time_unit::ms;
+                    else if (!strcmp(value, "us"))
+                        m_time_unit = time_unit::us;
+                    else if (!strcmp(value, "ns"))
+                        m_time_unit = time_unit::ns;
+                    else
+                        return false;
+
+                    i++;
+                }
+                else if (!strcmp(flag, "--affinity") && value)
+                {
+                    if (!strcmp(value, "none"))
+                        m_worker_affinity = worker_affinity::none;
+                    else if (!strcmp(value, "cpu"))
+                        m_worker_affinity = worker_affinity::cpu;
+                    else if (!strcmp(value, "numa"))
+                        m_worker_affinity = worker_affinity::numa;
+                    else
+                        return false;
+
+                    i++;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+
+            // the barriers are only checked within the label horizon, without one they would be silently ignored
+            if (m_labels.has_barriers() && !m_labels.m_horizon)
+                return false;
+
+            return true;
+        }
+
+        std::string cross_fingerprint() const
+        {
+            std::string fingerprint;
+            for (const std::string& symbol : m_reference_symbols)
+                fingerprint += symbol + ",";
+            for (size_t window : m_cross_windows)
+                fingerprint += std::to_string(window) + ",";
+
+            return m_reference_symbols.empty() ? "" : fingerprint;
+        }
+
+        // upper bound of every setting counted in rows, the kernels index rows with 32 bit
+        static constexpr uint64_t max_rows = UINT32_MAX;
+        static constexpr uint64_t max_shards = 4096;
+
+        /**
+         * @brief Parses a decimal count, unlike sscanf's %zu it rejects a sign, overflow and values above max.
+         * @param rest receives the first character after the digits, without it trailing characters are an error
+         */
+        template <typename T>
+        static bool parse_count(const char* text, T& value, uint64_t max = std::numeric_limits<T>::max(), const char** rest = nullptr)
+        {
+            if (!isdigit((unsigned char)*text))
+                return false;
+
+            char* end;
+            errno = 0;
+            const unsigned long long parsed = strtoull(text, &end, 10);
+            if (errno == ERANGE || parsed > max || (!rest && *end))
+                return false;
+
+            if (rest)
+                *rest = end;
+            value = (T)parsed;
+
+            return true;
+        }
+
+        // comma separated list, empty entries are skipped
+        static std::vector<std::string> split(const char* value)
+        {
+            std::vector<std::string> parts;
+            for (const char* begin = value;; begin++)
+            {
+                const char* end = strchr(begin, ',');
+                const size_t length = end ? end - begin : strlen(begin);
+                if (length)
+                    parts.emplace_back(begin, length);
+                if (!end)
+                    return parts;
+
+                begin = end;
+            }
+        }
+
+        /**
+         * @brief Describes every setting that changes the content of an output file.
+         */
+        std::string output_fingerprint() const
+        {
+            const indicator_config& i = m_indicators;
+
+            return "adosc=" + std::to_string(i.m_adosc_fast_period) + "," + std::to_string(i.m_adosc_slow_period)
+                + ";atr=" + std::to_string(i.m_atr_period)
+                + ";bbands=" + std::to_string(i.m_bbands_period) + "," + std::to_string(i.m_bbands_deviation_up) + "," + std::to_string(i.m_bbands_deviation_down)
+                + ";macd=" + std::to_string(i.m_macd_fast_period) + "," + std::to_string(i.m_macd_slow_period) + "," + std::to_string(i.m_macd_signal_period)
+                + ";mfi=" + std::to_string(i.m_mfi_period)
+                + ";rsi=" + std::to_string(i.m_rsi_period)
+                + ";columns=" + m_input_columns[0] + "," + m_input_columns[1] + "," + m_input_columns[2] + "," + m_input_columns[3] + "," + m_input_columns[4] + "," + m_input_columns[5]
+                + ";time=" + std::to_string((int)m_timestamp_format) + "," + std::to_string((int)m_time_unit)
+                + ";precision=" + std::to_string((int)m_output_precision) + "," + std::to_string((int)m_input_precision)
+                + ";normalize=" + std::to_string((int)m_normalization) + "," + std::to_string(m_normalization_window)
+                + ";validate=" + std::to_string((int)m_validation)
+                + ";gaps=" + std::to_string((int)m_gap_policy) + "," + std::to_string(m_gap_interval) + "," + std::to_string(m_max_fill)
+                + ";windows=" + std::to_string(m_export_window)
+                + ";cross=" + cross_fingerprint()
+                + ";labels=" + std::to_string(m_labels.m_horizon) + "," + std::to_string(m_labels.m_upper_barrier) + "," + std::to_string(m_labels.m_lower_barrier);
+        }
+    };
+
+    inline settings g_settings{};
+}
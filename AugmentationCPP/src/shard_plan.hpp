@@ -0,0 +1,232 @@
+#pragma once
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "logger.hpp"
+
+namespace program
+{
+    /**
+     * @brief Size balanced split of an input folder over several processes.
+     * The first process to start freezes the split into a plan file in the output folder, every later --shard and the
+     * --merge read it back, so processes started at different times or while files are still growing agree on it.
+     * Files are handed out largest first to the shard with the fewest bytes so far.
+     */
+    class shard_plan final
+    {
+    public:
+        struct input_file
+        {
+            std::filesystem::path m_path;
+            uintmax_t m_size;
+        };
+
+    private:
+        size_t m_shard_count;
+        std::vector<std::vector<input_file>> m_shards;
+
+    public:
+        explicit shard_plan(size_t shard_count) :
+            m_shard_count(shard_count), m_shards(shard_count)
+        {
+        }
+
+        /**
+         * @brief Loads the plan from the output folder, freezing it from the current input folder first if there is none.
+         * @param create false for --merge, which only checks what the shards were given
+         */
+        bool open(const std::filesystem::path& input_folder, const std::filesystem::path& output_folder, bool create)
+        {
+            const std::filesystem::path path = plan_file(output_folder, m_shard_count);
+
+            std::error_code error;
+            if (!std::filesystem::exists(path, error))
+            {
+                if (!create)
+                {
+                    g_log->error("SHARD", "No plan for %d shards in the output folder, no shard was started.", m_shard_count);
+
+                    return false;
+                }
+
+                // written aside and linked into place, so concurrently started shards keep whichever plan came first
+                const std::filesystem::path temporary_path = path.string() + "." + std::to_string(getpid());
+                if (!write_plan(temporary_path, balance(list_inputs(input_folder), m_shard_count)))
+                {
+                    g_log->error("SHARD", "Failed to write %s.", temporary_path.c_str());
+                    std::filesystem::remove(temporary_path, error);
+
+                    return false;
+                }
+
+                std::filesystem::create_hard_link(temporary_path, path, error);
+                std::filesystem::remove(temporary_path, error);
+            }
+
+            std::ifstream input_stream(path);
+            if (!input_stream)
+            {
+                g_log->error("SHARD", "Failed to read %s.", path.c_str());
+
+                return false;
+            }
+
+            // one "shard size name" line per input, in the order the shard processes them
+            std::set<std::string> planned;
+            size_t shard;
+            uintmax_t size;
+            while (input_stream >> shard >> size && input_stream.get() == ' ')
+            {
+                std::string name;
+                if (!std::getline(input_stream, name) || shard >= m_shard_count)
+                    break;
+
+                planned.insert(name);
+                m_shards[shard].push_back({ input_folder / name, size });
+            }
+
+            if (!input_stream.eof())
+            {
+                g_log->error("SHARD", "%s is malformed.", path.c_str());
+
+                return false;
+            }
+
+            size_t unplanned_count = 0;
+            for (const input_file& file : list_inputs(input_folder))
+                unplanned_count += !planned.count(file.m_path.filename().string());
+
+            if (unplanned_count)
+                g_log->warning("SHARD", "%d input file(s) arrived after the shard plan was frozen and are not processed.", unplanned_count);
+
+            return true;
+        }
+
+        static std::filesystem::path plan_file(const std::filesystem::path& output_folder, size_t shard_count)
+        {
+            return output_folder / (".shard_plan_of_" + std::to_string(shard_count));
+        }
+
+        /**
+         * @brief Greedy largest first assignment into the lightest shard, every shard keeps the largest first order.
+         */
+        static std::vector<std::vector<input_file>> balance(std::vector<input_file> files, size_t shard_count)
+        {
+            std::sort(files.begin(), files.end(), [](const input_file& a, const input_file& b)
+            {
+                if (a.m_size != b.m_size)
+                    return a.m_size > b.m_size;
+
+                return a.m_path.filename() < b.m_path.filename();
+            });
+
+            std::vector<std::vector<input_file>> shards(shard_count);
+            std::vector<uintmax_t> shard_bytes(shard_count, 0);
+            for (input_file& file : files)
+            {
+                const size_t lightest = std::min_element(shard_bytes.begin(), shard_bytes.end()) - shard_bytes.begin();
+                shard_bytes[lightest] += file.m_size;
+                shards[lightest].push_back(std::move(file));
+            }
+
+            return shards;
+        }
+
+        static bool write_plan(const std::filesystem::path& path, const std::vector<std::vector<input_file>>& shards)
+        {
+            std::ofstream output_stream(path, std::ios::trunc);
+            for (size_t shard = 0; shard < shards.size(); shard++)
+                for (const input_file& file : shards[shard])
+                    output_stream << shard << ' ' << file.m_size << ' ' << file.m_path.filename().string() << '\n';
+
+            return (bool)output_stream.flush();
+        }
+
+        const std::vector<input_file>& files(size_t shard) const
+        {
+            return m_shards.at(shard);
+        }
+
+        static std::vector<input_file> list_inputs(const std::filesystem::path& input_folder)
+        {
+            std::vector<input_file> files;
+            for (const auto& file : std::filesystem::directory_iterator(input_folder))
+                if (!file.is_directory() && file.path().filename().string()[0] != '.')
+                {
+                    std::error_code error;
+                    const uintmax_t size = file.file_size(error);
+                    files.push_back({ file.path(), error ? 0 : size });
+                }
+
+            return files;
+        }
+
+        static std::filesystem::path marker_file(const std::filesystem::path& output_folder, size_t shard, size_t shard_count)
+        {
+            return output_folder / (".shard_" + std::to_string(shard) + "_of_" + std::to_string(shard_count));
+        }
+
+        /**
+         * @brief Writes the names of the inputs the shard finished, read back by verify().
+         */
+        static bool write_marker(const std::filesystem::path& output_folder, size_t shard, size_t shard_count, const std::vector<std::string>& finished)
+        {
+            std::ofstream output_stream(marker_file(output_folder, shard, shard_count), std::ios::trunc);
+            for (const std::string& name : finished)
+                output_stream << name << '\n';
+
+            return (bool)output_stream;
+        }
+
+        /**
+         * @brief Merge step, checks that every shard ran and produced the outputs for all of its inputs.
+         * @param output_file maps an input file to the output it should have produced
+         */
+        template <typename OutputFile>
+        bool verify(const std::filesystem::path& output_folder, OutputFile&& output_file) const
+        {
+            size_t missing_count = 0;
+
+            for (size_t shard = 0; shard < m_shard_count; shard++)
+            {
+                std::ifstream input_stream(marker_file(output_folder, shard, m_shard_count));
+                if (!input_stream)
+                {
+                    g_log->error("SHARD", "Shard %d/%d did not finish, no marker in output folder.", shard, m_shard_count);
+                    missing_count += m_shards[shard].size();
+
+                    continue;
+                }
+
+                std::set<std::string> finished;
+                for (std::string name; std::getline(input_stream, name);)
+                    finished.insert(name);
+
+                for (const input_file& file : m_shards[shard])
+                {
+                    const std::string name = file.m_path.filename().string();
+
+                    std::error_code error;
+                    if (!finished.count(name) || !std::filesystem::exists(output_file(file.m_path), error))
+                    {
+                        g_log->error("SHARD", "Shard %d/%d is missing the output of %s.", shard, m_shard_count, name.c_str());
+                        missing_count++;
+                    }
+                }
+            }
+
+            if (missing_count)
+                return false;
+
+            g_log->info("SHARD", "All %d shards are complete.", m_shard_count);
+
+            return true;
+        }
+    };
+}
@@ -0,0 +1,437 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "candle.hpp"
+#include "augmentation/indicators.hpp"
+
+namespace program
+{
+    // Online versions of the TA-Lib functions used by symbol_processor. Every update is O(1) and repeats
+    // TA-Lib's arithmetic in the same order (seeding, Wilder smoothing, running sums), so the values are
+    // bit identical to a batch call over the whole history. Don't rewrite the expressions "more cleverly".
+
+    namespace ta_compat
+    {
+        inline bool is_zero(double value)
+        {
+            return -0.00000001 < value && value < 0.00000001;
+        }
+
+        inline bool is_zero_or_neg(double value)
+        {
+            return value < 0.00000001;
+        }
+
+        inline double period_to_k(size_t period)
+        {
+            return (double)2.0 / ((double)(period + 1));
+        }
+    }
+
+    // TA_INT_EMA with the default compatibility, seeded with the SMA of the first period values
+    class online_ema final
+    {
+        size_t m_period;
+        double m_k;
+        size_t m_count = 0;
+        double m_value = 0.0;
+
+    public:
+        online_ema(size_t period, double k) :
+            m_period(period), m_k(k)
+        {
+
+        }
+
+        bool update(double value, double& out)
+        {
+            if (m_count < m_period)
+            {
+                m_value += value;
+
+                if (++m_count < m_period)
+                    return false;
+
+                m_value = m_value / m_period;
+            }
+            else
+            {
+                m_value = ((value - m_value) * m_k) + m_value;
+            }
+
+            out = m_value;
+
+            return true;
+        }
+    };
+
+    class online_adosc final
+    {
+        size_t m_lookback;
+        double m_fast_k, m_one_minus_fast_k;
+        double m_slow_k, m_one_minus_slow_k;
+
+        size_t m_count = 0;
+        double m_ad = 0.0;
+        double m_fast_ema = 0.0;
+        double m_slow_ema = 0.0;
+
+    public:
+        online_adosc(size_t fast_period, size_t slow_period) :
+            m_lookback(std::max(fast_period, slow_period) - 1),
+            m_fast_k(ta_compat::period_to_k(fast_period)), m_one_minus_fast_k(1.0 - m_fast_k),
+            m_slow_k(ta_compat::period_to_k(slow_period)), m_one_minus_slow_k(1.0 - m_slow_k)
+        {
+
+        }
+
+        bool update(double high, double low, double close, double volume, double& out)
+        {
+            const double range = high - low;
+            if (range > 0.0)
+                m_ad += (((close - low) - (high - close)) / range) * volume;
+
+            if (m_count == 0)
+            {
+                m_fast_ema = m_ad;
+                m_slow_ema = m_ad;
+            }
+            else
+            {
+                m_fast_ema = (m_fast_k * m_ad) + (m_one_minus_fast_k * m_fast_ema);
+                m_slow_ema = (m_slow_k * m_ad) + (m_one_minus_slow_k * m_slow_ema);
+            }
+
+            if (m_count++ < m_lookback)
+                return false;
+
+            out = m_fast_ema - m_slow_ema;
+
+            return true;
+        }
+    };
+
+    class online_atr final
+    {
+        size_t m_period;
+
+        size_t m_count = 0;
+        double m_prev_close = 0.0;
+        double m_atr = 0.0;
+
+    public:
+        explicit online_atr(size_t period) :
+            m_period(period)
+        {
+
+        }
+
+        bool update(double high, double low, double close, double& out)
+        {
+            const size_t index = m_count++;
+
+            const double prev_close = m_prev_close;
+            m_prev_close = close;
+            if (index == 0)
+                return false;
+
+            double greatest = high - low;
+            const double val2 = std::fabs(prev_close - high);
+            if (val2 > greatest)
+                greatest = val2;
+            const double val3 = std::fabs(prev_close - low);
+            if (val3 > greatest)
+                greatest = val3;
+
+            if (index < m_period)
+            {
+                m_atr += greatest;
+
+                return false;
+            }
+
+            if (index == m_period)
+            {
+                // first value is the SMA of the first period true ranges
+                m_atr += greatest;
+                m_atr = m_atr / m_period;
+            }
+            else
+            {
+                m_atr *= m_period - 1;
+                m_atr += greatest;
+                m_atr /= m_period;
+            }
+
+            out = m_atr;
+
+            return true;
+        }
+    };
+
+    class online_bbands final
+    {
+        size_t m_period;
+        double m_deviation_up;
+        double m_deviation_down;
+
+        std::vector<double> m_window;
+        size_t m_count = 0;
+        double m_total = 0.0;
+        double m_total_squares = 0.0;
+
+    public:
+        online_bbands(size_t period, size_t deviation_up, size_t deviation_down) :
+            m_period(period), m_deviation_up((double)deviation_up), m_deviation_down((double)deviation_down), m_window(period)
+        {
+
+        }
+
+        bool update(double close, double& upper, double& middle, double& lower)
+        {
+            m_window[m_count % m_period] = close;
+            m_count++;
+
+            m_total += close;
+            double square = close;
+            square *= square;
+            m_total_squares += square;
+
+            if (m_count < m_period)
+                return false;
+
+            // TA_INT_SMA followed by TA_INT_stddev_using_precalc_ma
+            const double oldest = m_window[m_count % m_period];
+
+            const double total = m_total;
+            m_total -= oldest;
+            middle = total / m_period;
+
+            double mean_squares = m_total_squares / m_period;
+            square = oldest;
+            square *= square;
+            m_total_squares -= square;
+            square = middle;
+            square *= square;
+            mean_squares -= square;
+
+            const double deviation = !ta_compat::is_zero_or_neg(mean_squares) ? std::sqrt(mean_squares) : 0.0;
+
+            upper = middle + (deviation * m_deviation_up);
+            lower = middle - (deviation * m_deviation_down);
+
+            return true;
+        }
+    };
+
+    class online_macd final
+    {
+        size_t m_fast_period;
+        size_t m_slow_period;
+
+        online_ema m_fast_ema;
+        online_ema m_slow_ema;
+        online_ema m_signal_ema;
+        size_t m_count = 0;
+
+    public:
+        online_macd(size_t fast_period, size_t slow_period, size_t signal_period) :
+            m_fast_period(std::min(fast_period, slow_period)), m_slow_period(std::max(fast_period, slow_period)),
+            m_fast_ema(m_fast_period, ta_compat::period_to_k(m_fast_period)),
+            m_slow_ema(m_slow_period, ta_compat::period_to_k(m_slow_period)),
+            m_signal_ema(signal_period, ta_compat::period_to_k(signal_period))
+        {
+
+        }
+
+        bool update(double close, double& macd, double& signal, double& hist)
+        {
+            const size_t index = m_count++;
+
+            // TA-Lib starts both EMAs at the same index, so the fast one is seeded from the
+            // last fast_period values before the slow EMA becomes available
+            double fast, slow;
+            const bool has_slow = m_slow_ema.update(close, slow);
+            const bool has_fast = index + m_fast_period >= m_slow_period && m_fast_ema.update(close, fast);
+            if (!has_slow || !has_fast)
+                return false;
+
+            // TA_MACD only reports values once the signal line exists
+            const double value = fast - slow;
+            if (!m_signal_ema.update(value, signal))
+                return false;
+
+            macd = value;
+            hist = macd - signal;
+
+            return true;
+        }
+    };
+
+    class online_mfi final
+    {
+        struct money_flow
+        {
+            double m_positive;
+            double m_negative;
+        };
+
+        size_t m_period;
+
+        std::vector<money_flow> m_window;
+        size_t m_window_index = 0;
+        size_t m_count = 0;
+        double m_prev_typical = 0.0;
+        double m_positive_sum = 0.0;
+        double m_negative_sum = 0.0;
+
+    public:
+        explicit online_mfi(size_t period) :
+            m_period(period), m_window(period)
+        {
+
+        }
+
+        bool update(double high, double low, double close, double volume, double& out)
+        {
+            const size_t index = m_count++;
+
+            double typical = (high + low + close) / 3.0;
+            if (index == 0)
+            {
+                m_prev_typical = typical;
+
+                return false;
+            }
+
+            money_flow& flow = m_window[m_window_index];
+            if (index > m_period)
+            {
+                m_positive_sum -= flow.m_positive;
+                m_negative_sum -= flow.m_negative;
+            }
+
+            const double change = typical - m_prev_typical;
+            m_prev_typical = typical;
+            typical *= volume;
+
+            if (change < 0)
+            {
+                flow.m_negative = typical;
+                m_negative_sum += typical;
+                flow.m_positive = 0.0;
+            }
+            else if (change > 0)
+            {
+                flow.m_positive = typical;
+                m_positive_sum += typical;
+                flow.m_negative = 0.0;
+            }
+            else
+            {
+                flow.m_positive = 0.0;
+                flow.m_negative = 0.0;
+            }
+
+            if (++m_window_index == m_period)
+                m_window_index = 0;
+
+            if (index < m_period)
+                return false;
+
+            const double total = m_positive_sum + m_negative_sum;
+            out = total < 1.0 ? 0.0 : 100.0 * (m_positive_sum / total);
+
+            return true;
+        }
+    };
+
+    class online_rsi final
+    {
+        size_t m_period;
+
+        size_t m_count = 0;
+        double m_prev_close = 0.0;
+        double m_gain = 0.0;
+        double m_loss = 0.0;
+
+    public:
+        explicit online_rsi(size_t period) :
+            m_period(period)
+        {
+
+        }
+
+        bool update(double close, double& out)
+        {
+            const size_t index = m_count++;
+
+            const double change = close - m_prev_close;
+            m_prev_close = close;
+            if (index == 0)
+                return false;
+
+            if (index > m_period)
+            {
+                m_loss *= (m_period - 1);
+                m_gain *= (m_period - 1);
+            }
+
+            if (change < 0)
+                m_loss -= change;
+            else
+                m_gain += change;
+
+            if (index < m_period)
+                return false;
+
+            m_loss /= m_period;
+            m_gain /= m_period;
+
+            const double total = m_gain + m_loss;
+            out = !ta_compat::is_zero(total) ? 100.0 * (m_gain / total) : 0.0;
+
+            return true;
+        }
+    };
+
+    /**
+     * @brief All indicators of one symbol, fills the indicator columns of each candle pushed through it.
+     * Columns of indicators that are still in their lookback period keep their value of 0.
+     */
+    class stream_state final
+    {
+        online_adosc m_adosc;
+        online_atr m_atr;
+        online_bbands m_bbands;
+        online_macd m_macd;
+        online_mfi m_mfi;
+        online_rsi m_rsi;
+
+    public:
+        explicit stream_state(const indicator_config& config) :
+            m_adosc(config.m_adosc_fast_period, config.m_adosc_slow_period),
+            m_atr(config.m_atr_period),
+            m_bbands(config.m_bbands_period, config.m_bbands_deviation_up, config.m_bbands_deviation_down),
+            m_macd(config.m_macd_fast_period, config.m_macd_slow_period, config.m_macd_signal_period),
+            m_mfi(config.m_mfi_period),
+            m_rsi(config.m_rsi_period)
+        {
+
+        }
+
+        void update(candle& c)
+        {
+            m_adosc.update(c.m_high, c.m_low, c.m_close, c.m_volume, c.m_adosc);
+            m_atr.update(c.m_high, c.m_low, c.m_close, c.m_atr);
+            m_bbands.update(c.m_close, c.m_upper_band, c.m_middle_band, c.m_lower_band);
+            m_macd.update(c.m_close, c.m_macd, c.m_macd_signal, c.m_macd_hist);
+            m_mfi.update(c.m_high, c.m_low, c.m_close, c.m_volume, c.m_mfi);
+            m_rsi.update(c.m_close, c.m_rsi);
+        }
+    };
+}
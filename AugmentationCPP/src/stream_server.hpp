@@ -0,0 +1,378 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "csv_projection.hpp"
+#include "logger.hpp"
+#include "settings.hpp"
+#include "indicator_schema.hpp"
+#include "stream_indicators.hpp"
+#include "util/csv.h"
+
+namespace program
+{
+    /**
+     * @brief Serves the indicators of many symbols from candle streams on stdin and/or a local socket.
+     * Every input line is "symbol,event_time,open,close,high,low,volume" and is answered with the same
+     * candle followed by its indicators, in the column order of output_schema.
+     * Symbols are independent of the connection they arrive on, so a client may reconnect and continue.
+     */
+    class stream_server final
+    {
+        struct connection
+        {
+            int m_in_fd;
+            int m_out_fd;
+            std::string m_in_buffer;
+            std::string m_out_buffer;
+            // epoll events the socket is currently registered for
+            uint32_t m_events;
+        };
+
+        // pending answers above which a client is no longer read until it catches up, one read may add up to ~1 MiB more
+        static constexpr size_t max_pending_output = 1 << 20;
+
+        int m_epoll_fd = -1;
+        int m_listen_fd = -1;
+        std::string m_socket_path;
+        // stdin redirected from a regular file can't be polled and is read blocking instead
+        bool m_blocking_stdin = false;
+
+        std::unordered_map<int, std::unique_ptr<connection>> m_connections;
+        std::unordered_map<std::string, stream_state> m_symbols;
+
+    public:
+        stream_server() = default;
+        stream_server(const stream_server&) = delete;
+        stream_server& operator=(const stream_server&) = delete;
+
+        ~stream_server()
+        {
+            for (auto& [fd, conn] : m_connections)
+                if (fd != STDIN_FILENO)
+                    close(fd);
+
+            if (m_listen_fd >= 0)
+            {
+                close(m_listen_fd);
+                unlink(m_socket_path.c_str());
+            }
+            if (m_epoll_fd >= 0)
+                close(m_epoll_fd);
+        }
+
+        /**
+         * @param source "stdin" or "unix:<path>"
+         */
+        bool init(const std::string& source)
+        {
+            m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            if (m_epoll_fd < 0)
+                return false;
+
+            if (source == "stdin")
+            {
+                epoll_event event{};
+                event.events = EPOLLIN;
+                if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &event) < 0 && errno == EPERM)
+                {
+                    m_blocking_stdin = true;
+                    m_connections[STDIN_FILENO] = std::make_unique<connection>(connection{ STDIN_FILENO, STDOUT_FILENO, {}, {}, EPOLLIN });
+
+                    return true;
+                }
+                epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, STDIN_FILENO, nullptr);
+
+                return this->add_connection(STDIN_FILENO, STDOUT_FILENO);
+            }
+
+            if (source.rfind("unix:", 0) == 0)
+                return this->listen_unix(source.substr(5));
+
+            g_log->error("STREAM", "Unknown stream source %s, expected stdin or unix:<path>.", source.c_str());
+
+            return false;
+        }
+
+        /**
+         * @brief Handles events until running turns false or stdin was closed.
+         */
+        void run(const std::atomic<bool>& running)
+        {
+            if (m_blocking_stdin)
+            {
+                connection& conn = *m_connections.at(STDIN_FILENO);
+                while (running && this->receive(conn));
+
+                return;
+            }
+
+            epoll_event events[64];
+
+            while (running)
+            {
+                const int count = epoll_wait(m_epoll_fd, events, 64, 1000);
+                if (count < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+
+                    g_log->error("STREAM", "epoll_wait failed: %s", strerror(errno));
+
+                    return;
+                }
+
+                for (int i = 0; i < count; i++)
+                {
+                    const int fd = events[i].data.fd;
+
+                    if (fd == m_listen_fd)
+                    {
+                        this->accept_clients();
+
+                        continue;
+                    }
+
+                    auto it = m_connections.find(fd);
+                    if (it == m_connections.end())
+                        continue;
+
+                    connection& conn = *it->second;
+                    bool open = true;
+                    if (events[i].events & EPOLLOUT)
+                        open = this->flush(conn);
+                    if (open && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                        open = this->receive(conn);
+
+                    if (!open)
+                    {
+                        this->remove_connection(fd);
+
+                        // stdin only mode ends with its input
+                        if (fd == STDIN_FILENO && m_listen_fd < 0)
+                            return;
+                    }
+                }
+            }
+        }
+
+        size_t symbol_count() const
+        {
+            return m_symbols.size();
+        }
+
+    private:
+        bool listen_unix(const std::string& path)
+        {
+            sockaddr_un address{};
+            if (path.size() >= sizeof(address.sun_path))
+            {
+                g_log->error("STREAM", "Socket path %s is too long.", path.c_str());
+
+                return false;
+            }
+
+            address.sun_family = AF_UNIX;
+            strcpy(address.sun_path, path.c_str());
+
+            m_listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (m_listen_fd < 0)
+                return false;
+
+            unlink(path.c_str());
+            if (bind(m_listen_fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(m_listen_fd, SOMAXCONN) < 0)
+            {
+                g_log->error("STREAM", "Failed to listen on %s: %s", path.c_str(), strerror(errno));
+
+                return false;
+            }
+            m_socket_path = path;
+
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = m_listen_fd;
+
+            g_log->info("STREAM", "Listening on %s.", path.c_str());
+
+            return epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_listen_fd, &event) == 0;
+        }
+
+        void accept_clients()
+        {
+            for (;;)
+            {
+                const int fd = accept4(m_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0)
+                    return;
+
+                if (!this->add_connection(fd, fd))
+                    close(fd);
+            }
+        }
+
+        bool add_connection(int in_fd, int out_fd)
+        {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = in_fd;
+
+            if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, in_fd, &event) < 0)
+            {
+                g_log->error("STREAM", "Failed to watch fd %d: %s", in_fd, strerror(errno));
+
+                return false;
+            }
+
+            m_connections[in_fd] = std::make_unique<connection>(connection{ in_fd, out_fd, {}, {}, EPOLLIN });
+
+            return true;
+        }
+
+        void remove_connection(int fd)
+        {
+            epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            if (fd != STDIN_FILENO)
+                close(fd);
+
+            m_connections.erase(fd);
+        }
+
+        // reads what is available and answers every complete line, false once the peer is gone
+        bool receive(connection& conn)
+        {
+            char buffer[64 * 1024];
+            const ssize_t length = read(conn.m_in_fd, buffer, sizeof(buffer));
+            if (length < 0)
+                return errno == EAGAIN || errno == EINTR;
+            if (length == 0)
+                return false;
+
+            conn.m_in_buffer.append(buffer, length);
+
+            size_t line_begin = 0;
+            for (size_t line_end; (line_end = conn.m_in_buffer.find('\n', line_begin)) != std::string::npos; line_begin = line_end + 1)
+                this->handle_line(conn, &conn.m_in_buffer[line_begin], line_end - line_begin);
+            conn.m_in_buffer.erase(0, line_begin);
+
+            return this->flush(conn);
+        }
+
+        void handle_line(connection& conn, char* line, size_t length)
+        {
+            if (length && line[length - 1] == '\r')
+                length--;
+            line[length] = '\0';
+            if (!length)
+                return;
+
+            // symbol followed by six numeric columns
+            char* columns[7];
+            size_t column_count = 0;
+            for (char* cursor = line; cursor && column_count < 7; column_count++)
+            {
+                columns[column_count] = cursor;
+
+                cursor = strchr(cursor, ',');
+                if (cursor)
+                    *cursor++ = '\0';
+            }
+
+            uint64_t timestamp;
+            double values[candle::price_count];
+            try
+            {
+                if (column_count != 7)
+                    throw std::runtime_error("expected 7 columns");
+
+                // lines of different symbols may come from different feeds, so an unconfigured layout is detected per line
+                timestamp = timestamp_parser(g_settings.m_timestamp_format, g_settings.m_time_unit).parse(columns[1]);
+
+                // same number parser as the csv reader of the batch path, so both see identical inputs
+                for (size_t i = 0; i < candle::price_count; i++)
+                    parse_value(columns[i + 2], values[i]);
+            }
+            catch (const std::exception& e)
+            {
+                g_log->warning("STREAM", "Ignoring malformed line for %s: %s", line, e.what());
+
+                return;
+            }
+
+            candle c(0.0, values[0], values[1], values[2], values[3], values[4]);
+            c.m_timestamp = timestamp;
+
+            auto it = m_symbols.find(line);
+            if (it == m_symbols.end())
+                it = m_symbols.emplace(line, stream_state(g_settings.m_indicators)).first;
+            it->second.update(c);
+
+            char output[64 + 25 * (6 + output_schema::column_count)];
+            int written = snprintf(output, sizeof(output), "%s,%llu,%.17g,%.17g,%.17g,%.17g,%.17g",
+                line, (unsigned long long)c.m_timestamp, c.m_open, c.m_close, c.m_high, c.m_low, c.m_volume);
+
+            for (double candle::* field : output_schema::fields)
+                if (written > 0 && (size_t)written < sizeof(output))
+                    written += snprintf(output + written, sizeof(output) - written, ",%.17g", c.*field);
+
+            if (written > 0)
+            {
+                conn.m_out_buffer.append(output, std::min<size_t>(written, sizeof(output) - 1));
+                conn.m_out_buffer += '\n';
+            }
+        }
+
+        // writes as much pending output as the peer accepts, waits for EPOLLOUT for the rest and stops reading a client that falls behind
+        bool flush(connection& conn)
+        {
+            size_t offset = 0;
+            while (offset < conn.m_out_buffer.size())
+            {
+                const ssize_t written = write(conn.m_out_fd, conn.m_out_buffer.data() + offset, conn.m_out_buffer.size() - offset);
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    if (errno == EAGAIN)
+                        break;
+
+                    return false;
+                }
+
+                offset += written;
+            }
+            conn.m_out_buffer.erase(0, offset);
+
+            // stdout is written blocking, only sockets wait for EPOLLOUT
+            uint32_t events = 0;
+            if (conn.m_out_buffer.size() <= max_pending_output)
+                events |= EPOLLIN;
+            if (!conn.m_out_buffer.empty())
+                events |= EPOLLOUT;
+
+            if (conn.m_in_fd == conn.m_out_fd && events != conn.m_events)
+            {
+                epoll_event event{};
+                event.events = events;
+                event.data.fd = conn.m_in_fd;
+                epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, conn.m_in_fd, &event);
+
+                conn.m_events = events;
+            }
+
+            return true;
+        }
+    };
+}
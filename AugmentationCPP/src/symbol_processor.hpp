@@ -1,6 +1,17 @@
 #pragma once
 #include "common.hpp"
+#include "binary_input.hpp"
 #include "candle.hpp"
+#include "csv_projection.hpp"
+#include "gap_filler.hpp"
+#include "indicator_schema.hpp"
+#include "input_validator.hpp"
+#include "memory_budget.hpp"
+#include "precision.hpp"
+#include "progress.hpp"
+#include "reference_loader.hpp"
+#include "stream_indicators.hpp"
+#include "augmentation/window_dataset.hpp"
 
 namespace program
 {
@@ -8,20 +19,27 @@ namespace program
     {
     private:
         std::filesystem::path m_input_file;
+        // kept for file_name(), filename() returns a temporary
+        std::string m_file_name;
         const char* m_out_dir;
 
         std::vector<std::unique_ptr<candle>> m_candles;
-        size_t m_alloc_size;
-        double* m_open;
-        double* m_close;
-        double* m_high;
-        double* m_low;
-        double* m_volume;
+        size_t m_alloc_size = 0;
+        double* m_open = nullptr;
+        double* m_close = nullptr;
+        double* m_high = nullptr;
+        double* m_low = nullptr;
+        double* m_volume = nullptr;
         const int m_columns = 5;
 
+        input_validator m_validator;
+        size_t m_dropped_rows = 0;
+        // streamed without the gap repair or sidecars the settings ask for, the output must not be cached
+        bool m_partial = false;
+
     public:
         symbol_processor(std::filesystem::path file_path, const char* out_dir) :
-            m_input_file(file_path), m_out_dir(out_dir)
+            m_input_file(file_path), m_file_name(file_path.filename().string()), m_out_dir(out_dir)
         {
 
         }
@@ -36,6 +54,8 @@ namespace program
 
         void allocate_arrays()
         {
+            // the arrays are filled right here by the worker that processes the file, with a pinned
+            // worker this first touch places their pages on the worker's NUMA node
             m_alloc_size = m_candles.size();
 
             m_open = new double[m_alloc_size];
@@ -55,30 +75,79 @@ namespace program
                 m_volume[i] = candle->m_volume;
             }
 
-            g_log->verbose("SYMBOL_PROCESSOR", "Allocated double arrays of %d bytes for %s.", m_alloc_size * sizeof(double) * m_columns, m_input_file.filename().c_str());
+            g_log->verbose("SYMBOL_PROCESSOR", "Allocated double arrays of %d bytes for %s on node %d.", m_alloc_size * sizeof(double) * m_columns, m_input_file.filename().c_str(), thread_pool::current_node());
         }
 
         const char* const file_name()
         {
-            return m_input_file.filename().c_str();
+            return m_file_name.c_str();
         }
 
-        bool read_input_file()
+        /**
+         * @param row called with the timestamp and the open, close, high, low and volume of every valid row
+         * @param whole_file whether the io_uring backend may load the whole file at once
+         */
+        template <typename Row>
+        bool read_input_file(Row&& row, bool whole_file = true)
         {
-            io::CSVReader<6> input_stream(m_input_file.string().c_str());
-            input_stream.read_header(io::ignore_missing_column | io::ignore_extra_column, "event_time", "open", "close", "high", "low", "volume");
+            // rows the validator drops never reach the caller
+            const auto valid_row = [&](uint64_t timestamp, const double* values)
+            {
+                if (g_settings.m_validation != validation_mode::off && m_validator.check(values) && g_settings.m_validation == validation_mode::drop)
+                    m_dropped_rows++;
+                else
+                    row(timestamp, values);
+            };
+
+            const input_format format = binary_input::detect(m_input_file);
+            if (format != input_format::csv)
+                return this->read_binary_input(format, valid_row);
+
+            uring_queue* queue = whole_file ? this->uring() : nullptr;
+            if (queue)
+            {
+                // load the whole file with batched reads and parse it from memory
+                std::vector<char> file_buffer;
+                if (queue->read_file(m_input_file, file_buffer))
+                {
+                    projected_csv_reader<6> input_stream(m_input_file.string(), file_buffer.data(), file_buffer.data() + file_buffer.size());
+                    return this->parse_input(input_stream, valid_row);
+                }
+
+                // a torn down ring says nothing about the file, read it again below
+                if (queue->is_valid())
+                {
+                    g_log->error("SYMBOL_PROCESSOR", "Failed to read %s through io_uring.", this->file_name());
+
+                    return false;
+                }
+                g_log->warning("SYMBOL_PROCESSOR", "Reading %s again with posix I/O.", this->file_name());
+            }
+
+            projected_csv_reader<6> input_stream(m_input_file.string().c_str());
+            return this->parse_input(input_stream, valid_row);
+        }
 
+        template <typename Row>
+        bool parse_input(projected_csv_reader<6>& input_stream, Row& row)
+        {
             try
             {
-                //std::uint64_t timestamp;
-                double timestamp, open, close, high, low, volume;
-                while (input_stream.read_row(timestamp, open, close, high, low, volume))
+                // only the configured columns are split and converted, the rest of a wide row is skipped
+                input_stream.read_header(g_settings.m_input_columns);
+
+                // the timestamp column keeps its integer digits, the layout and unit are detected on the first row
+                timestamp_parser timestamps(g_settings.m_timestamp_format, g_settings.m_time_unit);
+                std::array<char*, 6> columns;
+                double values[candle::price_count];
+                while (input_stream.read_row(columns))
                 {
-                    std::unique_ptr<candle> new_candle = std::make_unique<candle>(timestamp, open, close, high, low, volume);
+                    const uint64_t timestamp = input_stream.parse(columns[0], timestamps);
+                    for (size_t i = 0; i < candle::price_count; i++)
+                        input_stream.parse(columns[i + 1], values[i]);
 
-                    m_candles.push_back(std::move(new_candle));
+                    row(timestamp, values);
                 }
-
             }
             catch(const std::exception& e)
             {
@@ -87,190 +156,649 @@ namespace program
                 return false;
             }
 
-            g_log->verbose("SYMBOL_PROCESSOR", "Loaded %d candles from %s", m_candles.size(), this->file_name());
+            return true;
+        }
+
+        template <typename Row>
+        bool read_binary_input(input_format format, Row& row)
+        {
+            // a .bin input in the output folder would be replaced by its own output while it is mapped
+            std::error_code code;
+            if (std::filesystem::equivalent(m_input_file, output_file(m_input_file, m_out_dir), code))
+            {
+                g_log->error("SYMBOL_PROCESSOR", "%s would be overwritten by its own output, use another output folder.", this->file_name());
+
+                return false;
+            }
+
+            std::string warning, error;
+            if (format == input_format::candle_rows && !binary_input::check_run_settings(m_input_file, warning, error))
+            {
+                g_log->error("SYMBOL_PROCESSOR", "Refusing to read %s: %s.", this->file_name(), error.c_str());
+
+                return false;
+            }
+            if (!warning.empty())
+                g_log->warning("SYMBOL_PROCESSOR", "Reading the prices of %s as they are: %s.", this->file_name(), warning.c_str());
+
+            // raw columns carry the epochs of the vendor, outputs of a previous run are in --time-unit already
+            timestamp_parser timestamps(g_settings.m_timestamp_format, g_settings.m_time_unit);
+            const auto normalized_row = [&](uint64_t timestamp, const double* values)
+            {
+                row(format == input_format::ohlcv_columns ? timestamps.normalize(timestamp) : timestamp, values);
+            };
+
+            bool success;
+            try
+            {
+                success = binary_input::read(m_input_file, format, g_settings.m_input_precision, normalized_row, error);
+            }
+            catch (const std::exception& e)
+            {
+                success = false;
+                error = e.what();
+            }
+
+            if (!success)
+            {
+                g_log->error("SYMBOL_PROCESSOR", "Failure while reading %s: %s", this->file_name(), error.c_str());
+
+                return false;
+            }
 
             return true;
         }
 
-        void calculate_adosc(const size_t fast_period = 24, const size_t slow_period = 45)
+        bool load_candles()
         {
-            g_log->verbose("SYMBOL_PROCESSOR", "Starting processing of ADOSC for %s", this->file_name());
+            const bool loaded = this->read_input_file([this](uint64_t timestamp, const double* values)
+            {
+                std::unique_ptr<candle> new_candle = std::make_unique<candle>(0.0, values[0], values[1], values[2], values[3], values[4]);
+                new_candle->m_timestamp = timestamp;
 
-            double* tmp_adosc = new double[m_alloc_size];
+                m_candles.push_back(std::move(new_candle));
+            });
 
-            int beginIdx, endIdx;
-            TA_ADOSC(0, m_alloc_size, m_high, m_low, m_close, m_volume, fast_period, slow_period, &beginIdx, &endIdx, tmp_adosc);
+            if (loaded)
+                g_log->verbose("SYMBOL_PROCESSOR", "Loaded %d candles from %s", m_candles.size(), this->file_name());
 
-            for (size_t i = beginIdx; i < endIdx; i++)
-                m_candles.at(i)->m_adosc = tmp_adosc[i];
+            return loaded;
+        }
 
-            delete[] tmp_adosc;
+        /**
+         * @brief Returns the io_uring queue of the current worker when the uring backend was selected and is supported.
+         */
+        uring_queue* uring()
+        {
+            if (g_settings.m_io_backend != io_backend::uring)
+                return nullptr;
 
-            g_log->verbose("SYMBOL_PROCESSOR", "Finished processing ADOSC on data for %s", this->file_name());
+            return uring_queue::get();
         }
 
-        void calculate_atr(const size_t period_range = 24)
+        /**
+         * @brief Writes the checks and column statistics gathered while parsing as <stem>.validation.json.
+         * @return false when the report couldn't be written or strict validation found invalid rows
+         */
+        bool write_validation_report()
         {
-            g_log->verbose("SYMBOL_PROCESSOR", "Starting processing of ATR for %s", this->file_name());
+            std::filesystem::path report_file = output_file(m_input_file, m_out_dir).replace_extension(".validation.json");
+            std::ofstream report_stream(report_file, std::ios::trunc);
+            report_stream << m_validator.to_json(m_dropped_rows);
+            report_stream.close();
+
+            if (m_validator.invalid_rows())
+            {
+                const bool fails = g_settings.m_validation == validation_mode::strict;
+                if (fails)
+                    g_log->error("SYMBOL_PROCESSOR", "%s has %d invalid rows, see %s.", this->file_name(), m_validator.invalid_rows(), report_file.filename().c_str());
+                else
+                    g_log->warning("SYMBOL_PROCESSOR", "%s has %d invalid rows, %d were dropped.", this->file_name(), m_validator.invalid_rows(), m_dropped_rows);
+
+                if (fails)
+                    return false;
+            }
 
-            double* tmp_atr = new double[m_alloc_size];
+            return !report_stream.fail();
+        }
 
-            int beginIdx, endIdx;
-            TA_ATR(0, m_alloc_size, m_high, m_low, m_close, period_range, &beginIdx, &endIdx, tmp_atr);
+        /**
+         * @brief Puts the candles in order, fills gaps according to the policy and writes <stem>.gaps.json.
+         */
+        bool repair_gaps()
+        {
+            const gap_report report = gap_filler::repair(m_candles, g_settings.m_gap_policy, g_settings.m_gap_interval, g_settings.m_max_fill);
 
-            for (size_t i = beginIdx; i < endIdx; i++)
-                m_candles.at(i)->m_atr = tmp_atr[i];
+            if (report.m_gaps || report.m_duplicates || report.m_out_of_order)
+                g_log->verbose("SYMBOL_PROCESSOR", "%s has %d gaps (%d missing candles), %d duplicates and %d out of order rows.",
+                    this->file_name(), report.m_gaps, report.m_missing_rows, report.m_duplicates, report.m_out_of_order);
 
-            delete[] tmp_atr;
+            std::filesystem::path report_file = output_file(m_input_file, m_out_dir).replace_extension(".gaps.json");
+            std::ofstream report_stream(report_file, std::ios::trunc);
+            report_stream << report.to_json();
+            report_stream.close();
 
-            g_log->verbose("SYMBOL_PROCESSOR", "Finished processing ATR on data for %s", this->file_name());
+            return !report_stream.fail();
         }
 
-        void calculate_bollinger_bands(const size_t period_range = 20, const size_t optInNbDevUp = 2, const size_t optInNbDevDown = 2)
+        bool calculate_indicators()
         {
-            // optInNbDevUp & optInNbDevDown = standard deviation for upper and lower band, usually 2 is used
-            g_log->verbose("SYMBOL_PROCESSOR", "Starting processing of Bollinger Bands for %s", this->file_name());
+            g_log->verbose("SYMBOL_PROCESSOR", "Starting processing of indicators for %s", this->file_name());
 
-            double* tmp_upper_band = new double[m_alloc_size];
-            double* tmp_middle_band = new double[m_alloc_size];
-            double* tmp_lower_band = new double[m_alloc_size];
+            // one block for the indicator columns of the schema, scattered into the candles afterwards
+            std::vector<double> columns(m_alloc_size * output_schema::column_count);
 
-            int beginIdx, endIdx;
-            TA_MAType MAtype = TA_MAType_SMA;
-            TA_BBANDS(0, m_alloc_size, m_close, period_range, optInNbDevUp, optInNbDevDown, MAtype, &beginIdx, &endIdx, tmp_upper_band, tmp_middle_band, tmp_lower_band);
+            output_columns output;
+            output_schema::bind(output, columns.data(), m_alloc_size);
 
-            for (size_t i = beginIdx; i < endIdx; i++)
+            const compute_status status = compute_indicators({ m_high, m_low, m_close, m_volume, m_alloc_size }, output, g_settings.m_indicators);
+            if (status != compute_status::success)
             {
-                const std::unique_ptr<candle>& candle = m_candles.at(i);
+                g_log->error("SYMBOL_PROCESSOR", "Failed to calculate the indicators for %s: %s", this->file_name(), to_string(status));
 
-                candle->m_upper_band = tmp_upper_band[i];
-                candle->m_middle_band = tmp_middle_band[i];
-                candle->m_lower_band = tmp_lower_band[i];
+                return false;
             }
 
-            delete[] tmp_upper_band;
-            delete[] tmp_middle_band;
-            delete[] tmp_lower_band;
+            for (size_t i = 0; i < m_alloc_size; i++)
+                output_schema::scatter(columns.data(), m_alloc_size, i, *m_candles[i]);
+
+            g_log->verbose("SYMBOL_PROCESSOR", "Finished processing indicators on data for %s", this->file_name());
 
-            g_log->verbose("SYMBOL_PROCESSOR", "Finished processing BBANDS on data for %s", this->file_name());
+            return true;
         }
 
-        void calculate_macd(const size_t fast_period = 12, const size_t slow_period = 26, const size_t signal_period = 9)
+        void normalize()
         {
-            g_log->verbose("SYMBOL_PROCESSOR", "Starting processing of MACD for %s", this->file_name());
+            if (g_settings.m_normalization == normalization_mode::none)
+                return;
 
-            double* tmp_macd = new double[m_alloc_size];
-            double* tmp_macd_signal = new double[m_alloc_size];
-            double* tmp_macd_hist = new double[m_alloc_size];
+            // all value columns of a candle are normalized together, the timestamp is kept as is
+            rolling_normalizer normalizer(g_settings.m_normalization, g_settings.m_normalization_window, candle::value_count);
+            for (const std::unique_ptr<candle>& candle : m_candles)
+                normalizer.update(candle->values());
 
-            int beginIdx, endIdx;
-            TA_MACD(0, m_alloc_size, m_close, fast_period, slow_period, signal_period, &beginIdx, &endIdx, tmp_macd, tmp_macd_signal, tmp_macd_hist);
+            g_log->verbose("SYMBOL_PROCESSOR", "Normalized %d candles of %s", m_candles.size(), this->file_name());
+        }
 
-            for (size_t i = beginIdx; i < endIdx; i++)
+        /**
+         * @brief Processes the file within the global memory budget.
+         * The estimated footprint is reserved for the whole job, files whose estimate exceeds the budget are streamed.
+         */
+        bool run()
+        {
+            const size_t footprint = estimate_footprint(m_input_file);
+            if (!g_memory_budget.fits(footprint))
             {
-                const std::unique_ptr<candle>& candle = m_candles.at(i);
+                g_log->info("SYMBOL_PROCESSOR", "%s needs about %zu MiB, more than the memory budget, processing it as a stream.", this->file_name(), footprint >> 20);
 
-                candle->m_macd = tmp_macd[i];
-                candle->m_macd_signal = tmp_macd_signal[i];
-                candle->m_macd_hist = tmp_macd_hist[i];
+                memory_budget::reservation reservation(g_memory_budget, streaming_footprint);
+                return this->start_streaming();
             }
 
-            delete[] tmp_macd;
-            delete[] tmp_macd_signal;
-            delete[] tmp_macd_hist;
+            memory_budget::reservation reservation(g_memory_budget, footprint);
+            return this->start();
+        }
 
-            g_log->verbose("SYMBOL_PROCESSOR", "Finished processing MFI on data for %s", this->file_name());
+        // true when run() streamed the file and left out what only the batch path produces
+        bool partial() const
+        {
+            return m_partial;
         }
 
-        void calculate_mfi(const size_t period_range = 30)
+        /**
+         * @brief Upper estimate of the memory a batch job needs: row count times the bytes every row occupies
+         * in the candles, the input and indicator columns and the enabled sidecars.
+         */
+        static size_t estimate_footprint(const std::filesystem::path& file)
         {
-            g_log->verbose("SYMBOL_PROCESSOR", "Starting processing of MFI for %s", this->file_name());
+            std::error_code code;
+            const size_t file_size = std::filesystem::file_size(file, code);
+            if (code)
+                return 0;
+
+            size_t rows;
+            size_t buffered = 0;
+            switch (binary_input::detect(file))
+            {
+            case input_format::candle_rows:
+                rows = file_size / row_format::row_sizes[(int)g_settings.m_input_precision];
 
-            double* tmp_mfi = new double[m_alloc_size];
+                break;
+            case input_format::ohlcv_columns:
+                rows = file_size / (sizeof(uint64_t) + binary_input::price_count * sizeof(double));
 
-            int beginIdx, endIdx;
-            TA_MFI(0, m_alloc_size, m_high, m_low, m_close, m_volume, period_range, &beginIdx, &endIdx, tmp_mfi);
+                break;
+            default:
+            {
+                // average length of the complete data lines in the first block, the header is skipped as it is often
+                // longer than a row and would make the estimate too low; later rows can still be shorter, hence the margin
+                char sample[1 << 16];
+                std::ifstream stream(file, std::ios::binary);
+                stream.read(sample, sizeof(sample));
+                const char* const sample_end = sample + stream.gcount();
+                const char* first = std::find((const char*)sample, sample_end, '\n');
+                first = first == sample_end ? sample : first + 1;
+
+                size_t lines = 0;
+                size_t line_bytes = 0;
+                for (const char* line = first; (line = std::find(line, sample_end, '\n')) != sample_end; line++)
+                {
+                    lines++;
+                    line_bytes = line + 1 - first;
+                }
+                const size_t line_length = lines ? line_bytes / lines : (size_t)(sample_end - sample);
+                rows = file_size / std::max<size_t>(line_length, 1) + 1;
+                rows += rows / 8;
 
-            for (size_t i = beginIdx; i < endIdx; i++)
-                m_candles.at(i)->m_mfi = tmp_mfi[i];
+                // the io_uring backend holds the whole text while parsing
+                if (g_settings.m_io_backend == io_backend::uring)
+                    buffered = file_size;
 
-            delete[] tmp_mfi;
+                break;
+            }
+            }
 
-            g_log->verbose("SYMBOL_PROCESSOR", "Finished processing MFI on data for %s", this->file_name());
+            // candle, its pointer and the allocator header, five input columns and the indicator block
+            size_t row_bytes = sizeof(candle) + 2 * sizeof(void*) + 5 * sizeof(double) + output_schema::column_count * sizeof(double);
+            if (g_settings.m_gap_policy != gap_policy::off)
+                row_bytes += sizeof(uint64_t) + sizeof(void*);
+            // filling stops once a file gained as many rows as it had, see gap_filler
+            if (g_settings.m_gap_policy == gap_policy::ffill || g_settings.m_gap_policy == gap_policy::zero_volume)
+                rows *= 2;
+            if (g_settings.m_labels.m_horizon)
+                row_bytes += sizeof(double) + (g_settings.m_labels.has_barriers() ? sizeof(uint32_t) + sizeof(int8_t) + 2 * sizeof(double) * (size_t)std::log2((double)g_settings.m_labels.m_horizon + 1) : 0);
+            if (!g_references.empty())
+                row_bytes += 3 * sizeof(double) + g_references.size() * g_settings.m_cross_windows.size() * cross_asset_features::feature_count * sizeof(double);
+
+            return rows * row_bytes + buffered;
         }
 
-        void calculate_rsi(const size_t period_range = 14)
+        // the row block of start_streaming and the online indicator state
+        static constexpr size_t streaming_rows = 4096;
+        static constexpr size_t streaming_footprint = streaming_rows * (sizeof(candle) + sizeof(candle_f32)) + (1 << 20);
+
+        bool start()
         {
-            g_log->verbose("SYMBOL_PROCESSOR", "Starting processing of RSI for %s", this->file_name());
+            progress_clock::time_point stage_begin = progress_clock::now();
+            if (!this->load_candles()) return false;
+            g_progress.add(pipeline_stage::read, m_candles.size(), this->input_size(), stage_begin);
 
-            double* tmp_rsi = new double[m_alloc_size];
+            if (g_settings.m_validation != validation_mode::off && !this->write_validation_report()) return false;
 
-            int beginIdx, endIdx;
-            TA_RSI(0, m_alloc_size, m_close, period_range, &beginIdx, &endIdx, tmp_rsi);
+            stage_begin = progress_clock::now();
+            if (g_settings.m_gap_policy != gap_policy::off && !this->repair_gaps()) return false;
 
-            for (size_t i = beginIdx; i < endIdx; i++)
-                m_candles.at(i)->m_rsi = tmp_rsi[i];
+            this->allocate_arrays();
+
+            // do our indicator calculation
+            if (!this->calculate_indicators()) return false;
+            this->normalize();
+            progress_clock::duration compute_time = progress_clock::now() - stage_begin;
+
+            stage_begin = progress_clock::now();
+            if (!this->write_binary_out()) return false;
+            g_progress.add(pipeline_stage::write, m_candles.size(), m_candles.size() * row_format::row_sizes[(int)g_settings.m_output_precision], stage_begin);
+
+            // the sidecars count as compute time, the file is a single compute observation
+            stage_begin = progress_clock::now();
+            const bool written = (!g_settings.m_export_window || this->write_window_index())
+                && (g_references.empty() || this->write_cross_asset_features())
+                && (!g_settings.m_labels.m_horizon || this->write_labels());
+            compute_time += progress_clock::now() - stage_begin;
+            g_progress.add(pipeline_stage::compute, m_candles.size(), 0, compute_time);
+
+            return written;
+        }
 
-            delete[] tmp_rsi;
+        uint64_t input_size() const
+        {
+            std::error_code code;
+            const uintmax_t size = std::filesystem::file_size(m_input_file, code);
 
-            g_log->verbose("SYMBOL_PROCESSOR", "Finished processing RSI on data for %s", this->file_name());
+            return code ? 0 : size;
         }
 
+        /**
+         * @brief Processes the file row by row with the online indicators, for inputs larger than the memory budget.
+         * Memory stays constant as rows are converted and written in blocks. Validation and normalization work the same
+         * as in start(), the repairs and sidecars that need the whole series (gaps, windows, cross asset features and
+         * labels) are skipped.
+         */
+        bool start_streaming()
+        {
+            m_partial = g_settings.m_gap_policy != gap_policy::off || g_settings.m_export_window || !g_references.empty() || g_settings.m_labels.m_horizon;
+            if (m_partial)
+                g_log->warning("SYMBOL_PROCESSOR", "%s is streamed, its gaps aren't repaired and no windows, cross asset features or labels are written.", this->file_name());
+
+            std::ofstream output_stream(output_file(m_input_file, m_out_dir), std::ios::binary | std::ios::trunc);
+
+            stream_state state(g_settings.m_indicators);
+            std::unique_ptr<rolling_normalizer> normalizer;
+            if (g_settings.m_normalization != normalization_mode::none)
+                normalizer = std::make_unique<rolling_normalizer>(g_settings.m_normalization, g_settings.m_normalization_window, candle::value_count);
+
+            std::vector<candle> block;
+            block.reserve(streaming_rows);
+            double max_error[candle::value_count]{};
+            size_t row_count = 0;
+
+            // every block is read, computed and written in turn so the stages can be timed separately
+            progress_clock::time_point read_begin = progress_clock::now();
+            const auto process_block = [&]()
+            {
+                g_progress.add(pipeline_stage::read, block.size(), 0, read_begin);
+
+                const progress_clock::time_point compute_begin = progress_clock::now();
+                for (candle& current : block)
+                {
+                    state.update(current);
+                    if (normalizer)
+                        normalizer->update(current.values());
+                }
+                g_progress.add(pipeline_stage::compute, block.size(), 0, compute_begin);
+
+                const progress_clock::time_point write_begin = progress_clock::now();
+                this->write_block(block, output_stream, max_error);
+                g_progress.add(pipeline_stage::write, block.size(), block.size() * row_format::row_sizes[(int)g_settings.m_output_precision], write_begin);
 
-        void start()
+                row_count += block.size();
+                block.clear();
+                read_begin = progress_clock::now();
+            };
+
+            const bool loaded = this->read_input_file([&](uint64_t timestamp, const double* values)
+            {
+                candle& current = block.emplace_back(0.0, values[0], values[1], values[2], values[3], values[4]);
+                current.m_timestamp = timestamp;
+
+                if (block.size() == streaming_rows)
+                    process_block();
+            }, false);
+            if (!loaded)
+                return false;
+
+            if (!block.empty())
+                process_block();
+            // the blocks were timed as they came, the input is only sized once
+            g_progress.add_bytes(pipeline_stage::read, this->input_size());
+            if (g_settings.m_output_precision != output_precision::f64)
+                g_precision_report.merge(max_error);
+
+            output_stream.close();
+            if (output_stream.fail())
+            {
+                g_log->error("SYMBOL_PROCESSOR", "Failed to write output of %s.", this->file_name());
+
+                return false;
+            }
+
+            g_log->verbose("SYMBOL_PROCESSOR", "Streamed %d candles of %s", row_count, this->file_name());
+
+            return g_settings.m_validation == validation_mode::off || this->write_validation_report();
+        }
+
+        static std::filesystem::path output_file(const std::filesystem::path& input_file, const char* out_dir)
         {
-            if (!this->read_input_file()) return;
+            return std::filesystem::path(out_dir) / (input_file.stem().string() + ".bin");
+        }
 
-            this->allocate_arrays();
+        /**
+         * @brief The .bin output and every sidecar the current settings write for an input.
+         */
+        static std::vector<std::filesystem::path> output_files(const std::filesystem::path& input_file, const char* out_dir)
+        {
+            const std::filesystem::path output = output_file(input_file, out_dir);
+            std::vector<std::filesystem::path> files{ output };
+            const auto sidecar = [&](bool enabled, const char* extension)
+            {
+                if (enabled)
+                    files.push_back(std::filesystem::path(output).replace_extension(extension));
+            };
 
-            // do our indicator calculation
-            this->calculate_adosc();
-            this->calculate_atr();
-            this->calculate_bollinger_bands();
-            this->calculate_macd();
-            this->calculate_mfi();
-            this->calculate_rsi();
-
-            this->write_binary_out();
+            sidecar(g_settings.m_validation != validation_mode::off, ".validation.json");
+            sidecar(g_settings.m_gap_policy != gap_policy::off, ".gaps.json");
+            sidecar(g_settings.m_export_window, ".windows");
+            sidecar(!g_references.empty(), ".cross");
+            sidecar(g_settings.m_labels.m_horizon, ".labels");
+
+            return files;
         }
 
         void write_to_out()
         {
             CSVWriter csv_output;
-            csv_output.newRow()
-                << "event_time" << "open" << "close" << "high" << "low" << "volume"
-                << "adosc"
-                << "atr"
-                << "upper_band" << "middle_band" << "lower_band"
-                << "macd" << "macd_signal" << "macd_hist"
-                << "mfi"
-                << "rsi";
+            output_schema::write_header(csv_output.newRow());
 
             for (const std::unique_ptr<candle>& candle : m_candles)
-            {
-                csv_output.newRow()
-                    << candle->m_timestamp << candle->m_open << candle->m_close << candle->m_high << candle->m_low << candle->m_volume
-                    << candle->m_adosc
-                    << candle->m_atr
-                    << candle->m_upper_band << candle->m_middle_band << candle->m_lower_band
-                    << candle->m_macd << candle->m_macd_signal << candle->m_macd_hist
-                    << candle->m_mfi
-                    << candle->m_rsi;
-            }
+                output_schema::write_row(csv_output.newRow(), *candle);
 
             std::string out_dir = m_out_dir / m_input_file.filename();
             csv_output.writeToFile(out_dir.c_str(), false);
         }
 
-        void write_binary_out()
+        bool write_binary_out()
         {
-            std::string out_dir = m_out_dir / m_input_file.stem();
-            std::ofstream output_stream(out_dir + ".bin", std::ios::binary | std::ios::trunc);
+            const std::filesystem::path out_file = output_file(m_input_file, m_out_dir);
+
+            if (uring_queue* queue = this->uring())
+            {
+                uring_file_writer writer(queue, out_file);
+                if (!writer.is_open())
+                {
+                    g_log->error("SYMBOL_PROCESSOR", "Failed to open output file for %s.", this->file_name());
+
+                    return false;
+                }
+
+                this->write_rows([&](const char* data, size_t size) { writer.write(data, size); });
+
+                if (writer.close())
+                    return true;
+
+                // a torn down ring says nothing about the file, write it again below
+                if (queue->is_valid())
+                {
+                    g_log->error("SYMBOL_PROCESSOR", "Failed to write output of %s through io_uring.", this->file_name());
+
+                    return false;
+                }
+                g_log->warning("SYMBOL_PROCESSOR", "Writing the output of %s again with posix I/O.", this->file_name());
+            }
+
+            std::ofstream output_stream(out_file, std::ios::binary | std::ios::trunc);
 
-            for (const std::unique_ptr<candle>& candle_struct : m_candles)
-                output_stream.write((char*)candle_struct.get(), sizeof(candle));
+            this->write_rows([&](const char* data, size_t size) { output_stream.write(data, size); });
 
             output_stream.close();
+
+            return !output_stream.fail();
+        }
+
+        /**
+         * @brief Writes the row offsets of all windows that lie past the indicator lookback and have strictly increasing timestamps.
+         */
+        bool write_window_index()
+        {
+            const size_t window = g_settings.m_export_window;
+            const size_t first_start = indicator_lookback(g_settings.m_indicators);
+
+            std::vector<uint64_t> starts;
+            size_t run_begin = 0;
+            for (size_t end = 0; end < m_candles.size(); end++)
+            {
+                if (end && m_candles[end]->m_timestamp <= m_candles[end - 1]->m_timestamp)
+                    run_begin = end;
+
+                if (end + 1 < window)
+                    continue;
+
+                const size_t start = end + 1 - window;
+                if (start >= first_start && start >= run_begin)
+                    starts.push_back(start);
+            }
+
+            window_index_header header{};
+            memcpy(header.m_magic, window_index_header::magic, sizeof(header.m_magic));
+            header.m_precision = (uint32_t)g_settings.m_output_precision;
+            header.m_window = (uint32_t)window;
+            header.m_row_count = m_candles.size();
+            header.m_window_count = starts.size();
+
+            std::filesystem::path index_file = output_file(m_input_file, m_out_dir).replace_extension(".windows");
+            std::ofstream index_stream(index_file, std::ios::binary | std::ios::trunc);
+            index_stream.write((const char*)&header, sizeof(header));
+            index_stream.write((const char*)starts.data(), starts.size() * sizeof(uint64_t));
+            index_stream.close();
+
+            g_log->verbose("SYMBOL_PROCESSOR", "Indexed %d windows of %d candles for %s", starts.size(), window, this->file_name());
+
+            return !index_stream.fail();
+        }
+
+        /**
+         * @brief Computes the rolling statistics against every reference symbol and writes them as <stem>.cross.
+         */
+        bool write_cross_asset_features()
+        {
+            const std::vector<size_t>& windows = g_settings.m_cross_windows;
+            const size_t columns_per_reference = windows.size() * cross_asset_features::feature_count;
+
+            std::vector<uint64_t> timestamps(m_alloc_size);
+            for (size_t i = 0; i < m_alloc_size; i++)
+                timestamps[i] = m_candles[i]->m_timestamp;
+
+            std::vector<double> columns(g_references.size() * columns_per_reference * m_alloc_size);
+            for (size_t r = 0; r < g_references.size(); r++)
+                cross_asset_features::compute(timestamps.data(), m_close, m_alloc_size, g_references[r], windows, columns.data() + r * columns_per_reference * m_alloc_size);
+
+            cross_asset_header header{};
+            memcpy(header.m_magic, cross_asset_header::magic, sizeof(header.m_magic));
+            header.m_reference_count = (uint32_t)g_references.size();
+            header.m_window_count = (uint32_t)windows.size();
+            header.m_row_count = m_alloc_size;
+
+            const std::vector<uint64_t> window_sizes(windows.begin(), windows.end());
+
+            std::filesystem::path cross_file = output_file(m_input_file, m_out_dir).replace_extension(".cross");
+            std::ofstream cross_stream(cross_file, std::ios::binary | std::ios::trunc);
+            cross_stream.write((const char*)&header, sizeof(header));
+            cross_stream.write((const char*)window_sizes.data(), window_sizes.size() * sizeof(uint64_t));
+            cross_stream.write((const char*)columns.data(), columns.size() * sizeof(double));
+            cross_stream.close();
+
+            g_log->verbose("SYMBOL_PROCESSOR", "Wrote cross asset features against %d references for %s", g_references.size(), this->file_name());
+
+            return !cross_stream.fail();
+        }
+
+        /**
+         * @brief Computes the look-ahead targets from the raw close prices and writes them as <stem>.labels.
+         */
+        bool write_labels()
+        {
+            const label_config& config = g_settings.m_labels;
+
+            std::vector<double> returns(m_alloc_size);
+            forward_returns(m_close, m_alloc_size, config.m_horizon, returns.data());
+
+            label_file_header header{};
+            memcpy(header.m_magic, label_file_header::magic, sizeof(header.m_magic));
+            header.m_horizon = (uint32_t)config.m_horizon;
+            header.m_has_barriers = config.has_barriers();
+            header.m_upper_barrier = config.m_upper_barrier;
+            header.m_lower_barrier = config.m_lower_barrier;
+            header.m_row_count = m_alloc_size;
+
+            std::filesystem::path label_file = output_file(m_input_file, m_out_dir).replace_extension(".labels");
+            std::ofstream label_stream(label_file, std::ios::binary | std::ios::trunc);
+            label_stream.write((const char*)&header, sizeof(header));
+            label_stream.write((const char*)returns.data(), returns.size() * sizeof(double));
+
+            if (config.has_barriers())
+            {
+                std::vector<int8_t> labels(m_alloc_size);
+                std::vector<uint32_t> offsets(m_alloc_size);
+                barrier_labels(m_close, m_alloc_size, config, labels.data(), offsets.data());
+
+                label_stream.write((const char*)offsets.data(), offsets.size() * sizeof(uint32_t));
+                label_stream.write((const char*)labels.data(), labels.size());
+            }
+            label_stream.close();
+
+            g_log->verbose("SYMBOL_PROCESSOR", "Wrote labels with a horizon of %d candles for %s", config.m_horizon, this->file_name());
+
+            return !label_stream.fail();
+        }
+
+        template <typename Write>
+        void write_rows(Write&& write)
+        {
+            switch (g_settings.m_output_precision)
+            {
+            case output_precision::f64:
+                for (const std::unique_ptr<candle>& candle_struct : m_candles)
+                    write((char*)candle_struct.get(), sizeof(candle));
+
+                break;
+            case output_precision::f32:
+                this->write_converted_rows<candle_f32>(write);
+
+                break;
+            case output_precision::bf16:
+                this->write_converted_rows<candle_bf16>(write);
+
+                break;
+            }
+        }
+
+        void write_block(const std::vector<candle>& block, std::ofstream& output_stream, double* max_error)
+        {
+            switch (g_settings.m_output_precision)
+            {
+            case output_precision::f64:
+                output_stream.write((const char*)block.data(), block.size() * sizeof(candle));
+
+                break;
+            case output_precision::f32:
+                write_converted_block<candle_f32>(block, output_stream, max_error);
+
+                break;
+            case output_precision::bf16:
+                write_converted_block<candle_bf16>(block, output_stream, max_error);
+
+                break;
+            }
+        }
+
+        template <typename Row>
+        static void write_converted_block(const std::vector<candle>& block, std::ofstream& output_stream, double* max_error)
+        {
+            std::vector<Row> rows(block.size());
+            for (size_t i = 0; i < block.size(); i++)
+                precision::convert_row(block[i], rows[i], max_error);
+
+            output_stream.write((const char*)rows.data(), rows.size() * sizeof(Row));
+        }
+
+        template <typename Row, typename Write>
+        void write_converted_rows(Write&& write)
+        {
+            constexpr size_t block_rows = 4096;
+
+            std::vector<Row> block(std::min(block_rows, m_candles.size()));
+            double max_error[candle::value_count]{};
+
+            for (size_t begin = 0; begin < m_candles.size(); begin += block_rows)
+            {
+                const size_t count = std::min(block_rows, m_candles.size() - begin);
+
+                for (size_t i = 0; i < count; i++)
+                    precision::convert_row(*m_candles[begin + i], block[i], max_error);
+
+                write((char*)block.data(), count * sizeof(Row));
+            }
+
+            g_precision_report.merge(max_error);
         }
     };
 }
@@ -1,10 +1,29 @@
 #include "logger.hpp"
+#include "progress.hpp"
+#include "settings.hpp"
 #include "thread_pool.hpp"
 
+#include <cstring>
+#include <pthread.h>
+
 namespace program
 {
-	thread_pool::thread_pool() : m_accept_jobs(true), m_data_condition(), m_job_stack(), m_lock()
+	thread_local size_t s_current_node = 0;
+
+	thread_pool::thread_pool() : m_accept_jobs(true), m_data_condition(), m_job_stacks(), m_next_node(0), m_lock(), m_active_jobs(0)
 	{
+		// the nodes have to be known before the first push, so they're not set up in the managing thread
+		if (g_settings.m_worker_affinity == worker_affinity::numa)
+		{
+			this->m_nodes = numa_topology::detect();
+		}
+		else
+		{
+			// one worker per cpu the process may use, pinned ones only land on those
+			this->m_nodes.push_back({ 0, numa_topology::allowed_cpus() });
+		}
+		this->m_job_stacks.resize(this->m_nodes.size());
+
 		this->m_managing_thread = std::thread(&thread_pool::create, this);
 
 		g_thread_pool = this;
@@ -17,13 +36,16 @@ namespace program
 
 	void thread_pool::create()
 	{
-		int thread_count = std::thread::hardware_concurrency();
+		int thread_count = 0;
+		for (const numa_node& node : this->m_nodes)
+			thread_count += node.m_cpus.size();
 
-		g_log->info("THREAD_POOL", "Allocated %d threads in pool.", thread_count);
+		g_log->info("THREAD_POOL", "Allocated %d threads in pool over %d node(s).", thread_count, this->m_nodes.size());
 		this->m_thread_pool.reserve(thread_count);
 
-		for (int i = 0; i < thread_count; i++)
-			this->m_thread_pool.push_back(std::thread(&thread_pool::run, this));
+		for (size_t node = 0; node < this->m_nodes.size(); node++)
+			for (int cpu : this->m_nodes.at(node).m_cpus)
+				this->m_thread_pool.push_back(std::thread(&thread_pool::run, this, node, cpu));
 	}
 
 	void thread_pool::destroy()
@@ -49,39 +71,135 @@ namespace program
 	{
 		std::unique_lock<std::mutex> lock(this->m_lock);
 
-		return !this->m_job_stack.empty();
+		for (const auto& job_stack : this->m_job_stacks)
+			if (!job_stack.empty())
+				return true;
+
+		return false;
 	}
 
 	void thread_pool::push(std::function<void()> func)
+	{
+		std::unique_lock<std::mutex> lock(this->m_lock);
+		const size_t node = this->m_next_node++ % this->m_job_stacks.size();
+		lock.unlock();
+
+		this->push(std::move(func), node);
+	}
+
+	void thread_pool::push(std::function<void()> func, size_t node)
 	{
 		if (func)
 		{
 			std::unique_lock<std::mutex> lock(this->m_lock);
-			this->m_job_stack.push(std::move(func));
+			this->m_job_stacks.at(node % this->m_job_stacks.size()).push(std::move(func));
 
 			lock.unlock();
 			this->m_data_condition.notify_all();
 		}
 	}
 
-	void thread_pool::run()
+	size_t thread_pool::node_count() const
+	{
+		return this->m_nodes.size();
+	}
+
+	size_t thread_pool::queued_jobs()
+	{
+		std::unique_lock<std::mutex> lock(this->m_lock);
+
+		size_t count = 0;
+		for (const auto& job_stack : this->m_job_stacks)
+			count += job_stack.size();
+
+		return count;
+	}
+
+	size_t thread_pool::active_jobs() const
 	{
+		return this->m_active_jobs.load(std::memory_order_relaxed);
+	}
+
+	size_t thread_pool::worker_count() const
+	{
+		size_t count = 0;
+		for (const numa_node& node : this->m_nodes)
+			count += node.m_cpus.size();
+
+		return count;
+	}
+
+	size_t thread_pool::current_node()
+	{
+		return s_current_node;
+	}
+
+	void thread_pool::pin(size_t node, int cpu)
+	{
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+
+		switch (g_settings.m_worker_affinity)
+		{
+		case worker_affinity::none:
+			return;
+		case worker_affinity::cpu:
+			CPU_SET(cpu, &cpu_set);
+
+			break;
+		case worker_affinity::numa:
+			// the scheduler may still move the worker between the cpus of its own node
+			for (int node_cpu : this->m_nodes.at(node).m_cpus)
+				CPU_SET(node_cpu, &cpu_set);
+
+			break;
+		}
+
+		if (int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set); error != 0)
+			g_log->warning("THREAD", "Failed to pin thread to cpu %d / node %d: %s", cpu, this->m_nodes.at(node).m_id, strerror(error));
+	}
+
+	bool thread_pool::pop(size_t node, std::function<void()>& job)
+	{
+		// our own node first so the file's memory stays local, then steal from the others instead of idling
+		for (size_t i = 0; i < this->m_job_stacks.size(); i++)
+		{
+			auto& job_stack = this->m_job_stacks.at((node + i) % this->m_job_stacks.size());
+			if (job_stack.empty()) continue;
+
+			job = std::move(job_stack.top());
+			job_stack.pop();
+
+			return true;
+		}
+
+		return false;
+	}
+
+	void thread_pool::run(size_t node, int cpu)
+	{
+		// pinned before the first job so every buffer a job allocates is first touched on this node
+		this->pin(node, cpu);
+		s_current_node = node;
+
 		for (;;)
 		{
 			std::unique_lock<std::mutex> lock(this->m_lock);
 
-			this->m_data_condition.wait(lock, [this]()
+			std::function<void()> job;
+			this->m_data_condition.wait(lock, [&]()
 			{
-				return !this->m_job_stack.empty() || !this->m_accept_jobs;
+				return this->pop(node, job) || !this->m_accept_jobs;
 			});
 
 			if (!this->m_accept_jobs) return;
-			if (this->m_job_stack.empty()) continue;
+			if (!job) continue;
 
-			auto job = std::move(this->m_job_stack.top());
-			this->m_job_stack.pop();
+			// counted before the lock is released, so a popped job is never invisible to has_jobs() and active_jobs() at once
+			this->m_active_jobs.fetch_add(1, std::memory_order_relaxed);
 			lock.unlock();
 
+			const progress_clock::time_point begin = progress_clock::now();
 			try
 			{
 				std::invoke(std::move(job));
@@ -91,6 +209,8 @@ namespace program
 				g_log->warning("THREAD", "Exception thrown while executing job in thread: %s", e.what());
 				//LOG(WARNING) << "Exception thrown while executing job in thread:" << std::endl << e.what();
 			}
+			g_progress.add_busy(std::chrono::duration_cast<std::chrono::nanoseconds>(progress_clock::now() - begin).count());
+			this->m_active_jobs.fetch_sub(1, std::memory_order_relaxed);
 		}
 
 		g_log->info("THREAD", "Thread %d exiting...", std::this_thread::get_id());
@@ -5,6 +5,9 @@
 #include <functional>
 #include <stack>
 #include <thread>
+#include <vector>
+
+#include "numa_topology.hpp"
 
 namespace program
 {
@@ -15,8 +18,10 @@ namespace program
         // 
 		std::condition_variable m_data_condition;
 
-        // stack (list) with functions with return type void
-		std::stack<std::function<void()>> m_job_stack;
+        // one stack (list) with functions with return type void per NUMA node, workers take jobs from their own node first
+		std::vector<std::stack<std::function<void()>>> m_job_stacks;
+        // node the next push without an explicit node goes to
+		size_t m_next_node;
         // mutex => thread lock prevent access violation errors
 		std::mutex m_lock;
         // vector (fancy list) with all the threads
@@ -24,6 +29,11 @@ namespace program
 
         // main thread to launch thread pool
 		std::thread m_managing_thread;
+
+        // nodes the workers are spread over, a single node when NUMA scheduling is disabled
+		std::vector<numa_node> m_nodes;
+        // workers currently running a job
+		std::atomic<size_t> m_active_jobs;
 	public:
         // constructor of class
 		thread_pool();
@@ -33,15 +43,29 @@ namespace program
         // destroy thread pool
 		void destroy();
 		bool has_jobs();
-        // push function / lambda on stack
+        // push function / lambda on stack, jobs are spread round robin over the nodes
 		void push(std::function<void()> func);
+        // push function / lambda on the stack of a specific node
+		void push(std::function<void()> func, size_t node);
+
+		size_t node_count() const;
+        // jobs pushed but not taken by a worker yet
+		size_t queued_jobs();
+		size_t active_jobs() const;
+		size_t worker_count() const;
+        // index of the node the calling worker is pinned to, 0 outside of the pool
+		static size_t current_node();
 	private:
         // create thread pool
 		void create();
         // tell the thread pool we're done using it and kill of all threads
 		void done();
         // infinite running function waiting for new jobs to be pushed on stack
-		void run();
+		void run(size_t node, int cpu);
+        // pins the calling thread according to g_settings.m_worker_affinity
+		void pin(size_t node, int cpu);
+        // takes the next job, preferring the given node, returns false if there is none
+		bool pop(size_t node, std::function<void()>& job);
 	};
 
     // inline == global
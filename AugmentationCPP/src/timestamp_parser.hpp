@@ -0,0 +1,309 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace program
+{
+    enum class time_unit
+    {
+        s,
+        ms,
+        us,
+        ns
+    };
+
+    enum class timestamp_format
+    {
+        // decided by the first timestamp that is parsed
+        detect,
+        // YYYY-MM-DD[(T| )HH:MM:SS[.f{1,9}]][Z|(+|-)HH[:]MM], UTC when there is no offset
+        iso8601,
+        epoch_s,
+        epoch_ms,
+        epoch_us,
+        epoch_ns
+    };
+
+    /**
+     * @brief Converts timestamp columns to integer epochs of one unit.
+     * ISO-8601 strings have a fixed layout, their digits and separators are validated eight bytes at a time and the
+     * calendar date is converted without any table or libc call. Integer epochs are converted eight digits at a time and
+     * never pass through a double, so nanosecond epochs keep every digit. Decimal or exponent notation (a float column
+     * exported by pandas) still goes through strtod. With timestamp_format::detect the layout and, for epochs, the unit
+     * (by magnitude: below 1e11 seconds, 1e14 milliseconds, 1e17 microseconds, nanoseconds above) are taken from the
+     * first parsed value and kept for the rest of the file.
+     */
+    class timestamp_parser final
+    {
+        static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the digit parsing reads little endian words");
+
+        static constexpr uint64_t powers_of_ten[10] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+        timestamp_format m_format;
+        time_unit m_unit;
+
+    public:
+        timestamp_parser(timestamp_format format, time_unit unit) :
+            m_format(format), m_unit(unit)
+        {
+
+        }
+
+        timestamp_format format() const
+        {
+            return m_format;
+        }
+
+        /**
+         * @brief Parses a trimmed, null terminated timestamp column.
+         * @throws std::invalid_argument when the text isn't a timestamp of the detected or configured format
+         */
+        uint64_t parse(const char* text)
+        {
+            if (m_format == timestamp_format::detect)
+                m_format = text[0] && text[1] && text[2] && text[3] && text[4] == '-' ? timestamp_format::iso8601 : timestamp_format::detect;
+
+            if (m_format == timestamp_format::iso8601)
+                return convert(parse_iso8601(text), time_unit::ns, m_unit);
+
+            uint64_t value;
+            if (parse_integer(text, value))
+                return this->normalize(value);
+
+            char* end;
+            const double decimal = strtod(text, &end);
+            if (end == text || *end || !(decimal >= 0.0) || decimal >= 1.8e19)
+                throw std::invalid_argument("invalid timestamp");
+
+            if (m_format == timestamp_format::detect)
+                m_format = detect_epoch(decimal);
+
+            const int shift = 3 * ((int)m_unit - (int)epoch_unit(m_format));
+            const double scaled = shift >= 0 ? decimal * powers_of_ten[shift] : decimal / powers_of_ten[-shift];
+            // rejected like an overflow in convert(), casting a double past 2^64 to uint64_t is undefined
+            if (scaled >= 1.8e19)
+                throw std::invalid_argument("timestamp out of range for the time unit");
+
+            return (uint64_t)scaled;
+        }
+
+        /**
+         * @brief Converts an integer epoch of the detected or configured unit, for inputs that store them as numbers.
+         */
+        uint64_t normalize(uint64_t epoch)
+        {
+            if (m_format == timestamp_format::detect)
+                m_format = detect_epoch((double)epoch);
+            if (m_format == timestamp_format::iso8601)
+                throw std::invalid_argument("ISO-8601 timestamps were configured for a numeric column");
+
+            return convert(epoch, epoch_unit(m_format), m_unit);
+        }
+
+        static const char* to_string(timestamp_format format)
+        {
+            switch (format)
+            {
+            case timestamp_format::detect: return "auto";
+            case timestamp_format::iso8601: return "iso8601";
+            case timestamp_format::epoch_s: return "s";
+            case timestamp_format::epoch_ms: return "ms";
+            case timestamp_format::epoch_us: return "us";
+            case timestamp_format::epoch_ns: return "ns";
+            }
+
+            return "?";
+        }
+
+    private:
+        static timestamp_format detect_epoch(double value)
+        {
+            if (value < 1e11)
+                return timestamp_format::epoch_s;
+            if (value < 1e14)
+                return timestamp_format::epoch_ms;
+
+            return value < 1e17 ? timestamp_format::epoch_us : timestamp_format::epoch_ns;
+        }
+
+        static time_unit epoch_unit(timestamp_format format)
+        {
+            return (time_unit)((int)format - (int)timestamp_format::epoch_s);
+        }
+
+        static uint64_t convert(uint64_t value, time_unit from, time_unit to)
+        {
+            if (to <= from)
+                return value / powers_of_ten[3 * ((int)from - (int)to)];
+
+            uint64_t result;
+            if (__builtin_mul_overflow(value, powers_of_ten[3 * ((int)to - (int)from)], &result))
+                throw std::invalid_argument("timestamp out of range for the time unit");
+
+            return result;
+        }
+
+        // true when all eight bytes are ASCII digits
+        static bool all_digits(uint64_t chunk)
+        {
+            return ((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+        }
+
+        // value of eight validated digits, the first one is the most significant
+        static uint64_t eight_digits(uint64_t chunk)
+        {
+            chunk -= 0x3030303030303030;
+            chunk = (chunk * 10) + (chunk >> 8);
+            chunk = (((chunk & 0x000000FF000000FF) * (100 + (1000000ull << 32))) + (((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ull << 32)))) >> 32;
+
+            return chunk;
+        }
+
+        static uint64_t load(const char* text)
+        {
+            uint64_t chunk;
+            memcpy(&chunk, text, sizeof(chunk));
+
+            return chunk;
+        }
+
+        // plain unsigned integers of up to 19 digits, anything else is left to strtod
+        static bool parse_integer(const char* text, uint64_t& value)
+        {
+            size_t length = 0;
+            while (text[length] >= '0' && text[length] <= '9')
+                length++;
+            if (!length || length > 19 || text[length])
+                return false;
+
+            value = 0;
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8)
+                value = value * 100000000 + eight_digits(load(text + i));
+            for (; i < length; i++)
+                value = value * 10 + (text[i] - '0');
+
+            return true;
+        }
+
+        // days since 1970-01-01 of a proleptic Gregorian date (Howard Hinnant's days_from_civil)
+        static int64_t days_from_civil(int64_t year, unsigned month, unsigned day)
+        {
+            year -= month <= 2;
+            const int64_t era = year / 400;
+            const unsigned year_of_era = (unsigned)(year - era * 400);
+            const unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+            const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+            return era * 146097 + (int64_t)day_of_era - 719468;
+        }
+
+        static unsigned days_in_month(unsigned year, unsigned month)
+        {
+            if (month == 2)
+                return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0 ? 29 : 28;
+
+            return month == 4 || month == 6 || month == 9 || month == 11 ? 30 : 31;
+        }
+
+        // nanoseconds since the epoch
+        static uint64_t parse_iso8601(const char* text)
+        {
+            const size_t length = strlen(text);
+            if (length < 10)
+                throw std::invalid_argument("invalid ISO-8601 timestamp");
+
+            // "YYYY-MM-" with the separators replaced by '0' has to be all digits
+            char date[8];
+            memcpy(date, text, 8);
+            if (date[4] != '-' || date[7] != '-')
+                throw std::invalid_argument("invalid ISO-8601 date");
+            date[4] = date[7] = '0';
+
+            uint64_t date_chunk = load(date);
+            if (!all_digits(date_chunk) || text[8] < '0' || text[8] > '9' || text[9] < '0' || text[9] > '9')
+                throw std::invalid_argument("invalid ISO-8601 date");
+
+            // YYYY0MM0 as a number, the zeros separate the fields
+            const uint64_t date_value = eight_digits(date_chunk);
+            const unsigned year = (unsigned)(date_value / 10000), month = (unsigned)(date_value / 10 % 100);
+            const unsigned day = (unsigned)((text[8] - '0') * 10 + (text[9] - '0'));
+            if (year < 1970 || month < 1 || month > 12 || day < 1 || day > days_in_month(year, month))
+                throw std::invalid_argument("ISO-8601 date out of range");
+
+            uint64_t seconds = (uint64_t)days_from_civil(year, month, day) * 86400;
+            uint64_t nanoseconds = 0;
+            const char* cursor = text + 10;
+
+            if (*cursor == 'T' || *cursor == ' ')
+            {
+                // "HH:MM:SS" with the colons replaced, the eight bytes are read from a copy so short inputs stay in bounds
+                char time[8] = {};
+                memcpy(time, cursor + 1, std::min<size_t>(8, length - 11));
+                if (length < 19 || time[2] != ':' || time[5] != ':')
+                    throw std::invalid_argument("invalid ISO-8601 time");
+                time[2] = time[5] = '0';
+
+                const uint64_t time_chunk = load(time);
+                if (!all_digits(time_chunk))
+                    throw std::invalid_argument("invalid ISO-8601 time");
+
+                const uint64_t time_value = eight_digits(time_chunk);
+                const uint64_t hour = time_value / 1000000, minute = time_value / 1000 % 100, second = time_value % 100;
+                if (hour > 23 || minute > 59 || second > 60)
+                    throw std::invalid_argument("ISO-8601 time out of range");
+                seconds += hour * 3600 + minute * 60 + second;
+                cursor += 9;
+
+                if (*cursor == '.' || *cursor == ',')
+                {
+                    // digits past nanoseconds are truncated
+                    size_t digits = 0;
+                    for (cursor++; *cursor >= '0' && *cursor <= '9'; cursor++, digits++)
+                        if (digits < 9)
+                            nanoseconds = nanoseconds * 10 + (*cursor - '0');
+                    if (!digits)
+                        throw std::invalid_argument("invalid ISO-8601 fraction");
+                    if (digits < 9)
+                        nanoseconds *= powers_of_ten[9 - digits];
+                }
+
+                if (*cursor == 'Z')
+                {
+                    cursor++;
+                }
+                else if (*cursor == '+' || *cursor == '-')
+                {
+                    const bool ahead = *cursor == '+';
+                    const char* offset = cursor + 1;
+                    const size_t minutes_at = offset[2] == ':' ? 3 : 2;
+                    for (size_t i : { (size_t)0, (size_t)1, minutes_at, minutes_at + 1 })
+                        if (offset[i] < '0' || offset[i] > '9')
+                            throw std::invalid_argument("invalid ISO-8601 offset");
+
+                    const uint64_t offset_seconds = ((offset[0] - '0') * 10 + (offset[1] - '0')) * 3600 + ((offset[minutes_at] - '0') * 10 + (offset[minutes_at + 1] - '0')) * 60;
+                    // local time ahead of UTC lies after the same UTC time
+                    if (ahead)
+                    {
+                        if (offset_seconds > seconds)
+                            throw std::invalid_argument("ISO-8601 timestamp before the epoch");
+                        seconds -= offset_seconds;
+                    }
+                    else
+                    {
+                        seconds += offset_seconds;
+                    }
+                    cursor = offset + minutes_at + 2;
+                }
+            }
+
+            if (*cursor)
+                throw std::invalid_argument("trailing characters after the ISO-8601 timestamp");
+
+            return seconds * 1000000000 + nanoseconds;
+        }
+    };
+}
@@ -0,0 +1,380 @@
+#include "logger.hpp"
+#include "uring_queue.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace program
+{
+    static int sys_io_uring_setup(unsigned entries, io_uring_params* params)
+    {
+        return (int)syscall(__NR_io_uring_setup, entries, params);
+    }
+
+    static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+    }
+
+    static int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args)
+    {
+        return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+    }
+
+    uring_queue::~uring_queue()
+    {
+        if (m_ring_fd != -1)
+            this->drain();
+        this->teardown();
+
+        free(m_buffer_memory);
+    }
+
+    void uring_queue::teardown()
+    {
+        if (m_ring_fd != -1)
+        {
+            close(m_ring_fd);
+            m_ring_fd = -1;
+        }
+
+        if (m_sqes) munmap(m_sqes, m_sqes_size);
+        if (m_cq_ring && m_cq_ring != m_sq_ring) munmap(m_cq_ring, m_cq_ring_size);
+        if (m_sq_ring) munmap(m_sq_ring, m_sq_ring_size);
+        m_sqes = nullptr;
+        m_cq_ring = m_sq_ring = nullptr;
+    }
+
+    bool uring_queue::init()
+    {
+        io_uring_params params{};
+        int fd = sys_io_uring_setup(queue_depth, &params);
+        if (fd < 0)
+            return false;
+
+        m_ring_fd = fd;
+
+        m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+
+        m_sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (m_sq_ring == MAP_FAILED)
+        {
+            m_sq_ring = nullptr;
+            return false;
+        }
+
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            m_cq_ring = m_sq_ring;
+        }
+        else
+        {
+            m_cq_ring = mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (m_cq_ring == MAP_FAILED)
+            {
+                m_cq_ring = nullptr;
+                return false;
+            }
+        }
+
+        m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            return false;
+        m_sqes = (io_uring_sqe*)sqes;
+
+        char* sq = (char*)m_sq_ring;
+        m_sq_head = (unsigned*)(sq + params.sq_off.head);
+        m_sq_tail = (unsigned*)(sq + params.sq_off.tail);
+        m_sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+        m_sq_array = (unsigned*)(sq + params.sq_off.array);
+
+        char* cq = (char*)m_cq_ring;
+        m_cq_head = (unsigned*)(cq + params.cq_off.head);
+        m_cq_tail = (unsigned*)(cq + params.cq_off.tail);
+        m_cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+        m_cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+        m_buffer_memory = (char*)aligned_alloc(4096, buffer_count * buffer_size);
+        if (!m_buffer_memory)
+            return false;
+
+        iovec iovecs[buffer_count];
+        for (unsigned i = 0; i < buffer_count; i++)
+        {
+            iovecs[i].iov_base = this->buffer_data(i);
+            iovecs[i].iov_len = buffer_size;
+        }
+
+        // fails on kernels with a small RLIMIT_MEMLOCK, we fall back to the posix backend in that case
+        if (sys_io_uring_register(fd, IORING_REGISTER_BUFFERS, iovecs, buffer_count) < 0)
+            return false;
+
+        m_operations.resize(buffer_count);
+        m_free_buffers.reserve(buffer_count);
+        for (int i = buffer_count - 1; i >= 0; i--)
+            m_free_buffers.push_back(i);
+
+        return true;
+    }
+
+    bool uring_queue::read_file(const std::filesystem::path& path, std::vector<char>& out)
+    {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) < 0)
+        {
+            close(fd);
+
+            return false;
+        }
+
+        const uint64_t size = file_stat.st_size;
+        out.resize(size);
+
+        const auto on_complete = [&](const operation& op, unsigned bytes)
+        {
+            memcpy(out.data() + op.m_offset + op.m_done, this->buffer_data(op.m_buffer) + op.m_done, bytes);
+        };
+
+        uint64_t next_offset = 0;
+        while (this->is_valid() && (next_offset < size || m_in_flight))
+        {
+            while (!m_failed && next_offset < size && !m_free_buffers.empty())
+            {
+                const unsigned length = (unsigned)std::min<uint64_t>(buffer_size, size - next_offset);
+
+                this->queue_operation({ IORING_OP_READ_FIXED, fd, this->acquire_buffer(), next_offset, length, 0 });
+                next_offset += length;
+            }
+
+            this->reap(1, on_complete);
+
+            if (m_failed)
+                next_offset = size;
+        }
+
+        close(fd);
+
+        return this->drain();
+    }
+
+    int uring_queue::acquire_buffer()
+    {
+        while (m_free_buffers.empty() && this->is_valid())
+            this->reap(1, nullptr);
+        if (m_free_buffers.empty())
+            return -1;
+
+        int buffer = m_free_buffers.back();
+        m_free_buffers.pop_back();
+
+        return buffer;
+    }
+
+    void uring_queue::submit_write(int fd, int buffer, uint64_t offset, unsigned length)
+    {
+        if (!this->is_valid())
+        {
+            m_failed = true;
+            m_free_buffers.push_back(buffer);
+
+            return;
+        }
+
+        this->queue_operation({ IORING_OP_WRITE_FIXED, fd, buffer, offset, length, 0 });
+
+        // writes are submitted eagerly so the device starts working while the next buffer is filled
+        this->reap(0, nullptr);
+    }
+
+    bool uring_queue::drain()
+    {
+        while (this->is_valid() && (m_in_flight || m_pending_submit))
+            this->reap(1, nullptr);
+
+        // failed operations only fail the current file, a torn down ring fails every later one as well
+        const bool success = !m_failed;
+        m_failed = !this->is_valid();
+
+        return success;
+    }
+
+    void uring_queue::queue_operation(const operation& op)
+    {
+        m_operations[op.m_buffer] = op;
+
+        const unsigned tail = *m_sq_tail;
+        const unsigned index = tail & *m_sq_mask;
+
+        io_uring_sqe* sqe = &m_sqes[index];
+        memset(sqe, 0, sizeof(io_uring_sqe));
+        sqe->opcode = op.m_opcode;
+        sqe->fd = op.m_fd;
+        sqe->addr = (uint64_t)(this->buffer_data(op.m_buffer) + op.m_done);
+        sqe->len = op.m_length - op.m_done;
+        sqe->off = op.m_offset + op.m_done;
+        sqe->buf_index = (uint16_t)op.m_buffer;
+        sqe->user_data = (uint64_t)op.m_buffer;
+
+        m_sq_array[index] = index;
+        __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+        if (op.m_done == 0)
+            m_in_flight++;
+        m_pending_submit++;
+    }
+
+    void uring_queue::reap(unsigned min_complete, const std::function<void(const operation&, unsigned)>& on_complete)
+    {
+        if (m_pending_submit || min_complete)
+        {
+            int ret;
+            do
+            {
+                ret = sys_io_uring_enter(m_ring_fd, m_pending_submit, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0);
+            } while (ret < 0 && errno == EINTR);
+
+            if (ret < 0)
+            {
+                g_log->error("URING", "io_uring_enter failed, this worker falls back to posix I/O: %s", strerror(errno));
+
+                // the kernel may still own the submitted operations and their buffers, so nothing is reclaimed:
+                // closing the ring cancels them and the queue is never used again, the buffer memory lives until the destructor
+                m_failed = true;
+                this->teardown();
+
+                return;
+            }
+
+            m_pending_submit -= std::min<unsigned>(ret, m_pending_submit);
+        }
+
+        unsigned head = *m_cq_head;
+        const unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+        {
+            const io_uring_cqe& cqe = m_cqes[head & *m_cq_mask];
+            operation& op = m_operations[cqe.user_data];
+
+            if (cqe.res > 0)
+            {
+                if (on_complete)
+                    on_complete(op, (unsigned)cqe.res);
+                op.m_done += cqe.res;
+
+                // short read or write, queue the remainder of the chunk again
+                if (op.m_done < op.m_length)
+                {
+                    this->queue_operation(op);
+
+                    continue;
+                }
+            }
+            else
+            {
+                m_failed = true;
+            }
+
+            m_in_flight--;
+            m_free_buffers.push_back(op.m_buffer);
+        }
+        __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    uring_queue* uring_queue::get()
+    {
+        static std::atomic<bool> unavailable = false;
+        thread_local std::unique_ptr<uring_queue> queue;
+
+        if (queue)
+            return queue->is_valid() ? queue.get() : nullptr;
+        if (unavailable)
+            return nullptr;
+
+        auto new_queue = std::make_unique<uring_queue>();
+        if (!new_queue->init())
+        {
+            if (!unavailable.exchange(true))
+                g_log->warning("URING", "io_uring is not supported by this kernel (%s), falling back to posix I/O.", strerror(errno));
+
+            return nullptr;
+        }
+
+        queue = std::move(new_queue);
+
+        return queue.get();
+    }
+
+    uring_file_writer::uring_file_writer(uring_queue* queue, const std::filesystem::path& path) :
+        m_queue(queue)
+    {
+        m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+
+    uring_file_writer::~uring_file_writer()
+    {
+        if (m_fd != -1)
+            this->close();
+    }
+
+    void uring_file_writer::write(const char* data, size_t size)
+    {
+        while (size)
+        {
+            if (m_buffer == -1)
+                m_buffer = m_queue->acquire_buffer();
+            // the ring was torn down, close() reports the failure
+            if (m_buffer == -1)
+                return;
+
+            const size_t to_copy = std::min(size, uring_queue::buffer_size - m_used);
+            memcpy(m_queue->buffer_data(m_buffer) + m_used, data, to_copy);
+
+            m_used += to_copy;
+            data += to_copy;
+            size -= to_copy;
+
+            if (m_used == uring_queue::buffer_size)
+                this->flush();
+        }
+    }
+
+    bool uring_file_writer::close()
+    {
+        if (m_used)
+            this->flush();
+
+        const bool success = m_queue->drain();
+
+        ::close(m_fd);
+        m_fd = -1;
+
+        return success;
+    }
+
+    void uring_file_writer::flush()
+    {
+        m_queue->submit_write(m_fd, m_buffer, m_offset, (unsigned)m_used);
+
+        m_offset += m_used;
+        m_buffer = -1;
+        m_used = 0;
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace program
+{
+    // thin wrapper around a raw io_uring instance with a set of registered (fixed) buffers,
+    // every worker thread owns its own queue so no locking is needed on submission
+    class uring_queue final
+    {
+    public:
+        static constexpr unsigned queue_depth = 32;
+        static constexpr unsigned buffer_count = 16;
+        static constexpr size_t buffer_size = 1 << 18;
+
+    private:
+        struct operation
+        {
+            uint8_t m_opcode;
+            int m_fd;
+            int m_buffer;
+            uint64_t m_offset;
+            unsigned m_length;
+            // bytes of m_length that already completed, short reads/writes are resubmitted
+            unsigned m_done;
+        };
+
+        int m_ring_fd = -1;
+
+        void* m_sq_ring = nullptr;
+        size_t m_sq_ring_size = 0;
+        void* m_cq_ring = nullptr;
+        size_t m_cq_ring_size = 0;
+        io_uring_sqe* m_sqes = nullptr;
+        size_t m_sqes_size = 0;
+
+        unsigned* m_sq_head;
+        unsigned* m_sq_tail;
+        unsigned* m_sq_mask;
+        unsigned* m_sq_array;
+        unsigned* m_cq_head;
+        unsigned* m_cq_tail;
+        unsigned* m_cq_mask;
+        io_uring_cqe* m_cqes;
+
+        char* m_buffer_memory = nullptr;
+        std::vector<int> m_free_buffers;
+        std::vector<operation> m_operations;
+        unsigned m_pending_submit = 0;
+        unsigned m_in_flight = 0;
+        bool m_failed = false;
+
+    public:
+        uring_queue() = default;
+        uring_queue(const uring_queue&) = delete;
+        uring_queue& operator=(const uring_queue&) = delete;
+        ~uring_queue();
+
+        /**
+         * @brief Sets up the ring and registers the fixed buffers.
+         * @return false if the kernel lacks io_uring support or refused the setup
+         */
+        bool init();
+        // false once io_uring_enter failed and the ring was torn down, the worker uses posix I/O from then on
+        bool is_valid() const { return m_ring_fd != -1; }
+
+        /**
+         * @brief Reads a whole file with up to queue_depth chunked reads in flight.
+         */
+        bool read_file(const std::filesystem::path& path, std::vector<char>& out);
+
+        // registered buffer handling for writers, see uring_file_writer, -1 once the ring was torn down
+        int acquire_buffer();
+        char* buffer_data(int buffer) const { return m_buffer_memory + buffer * buffer_size; }
+        void submit_write(int fd, int buffer, uint64_t offset, unsigned length);
+        // blocks until every submitted operation completed, false if any of them failed
+        bool drain();
+
+        // thread local queue of the calling worker, nullptr if io_uring is unavailable
+        static uring_queue* get();
+
+    private:
+        void teardown();
+        void queue_operation(const operation& op);
+        // submits pending entries and reaps at least min_complete completions,
+        // on_complete is called for every chunk of data that was transferred
+        void reap(unsigned min_complete, const std::function<void(const operation&, unsigned)>& on_complete);
+    };
+
+    // buffered writer that fills registered buffers and keeps their writes in flight
+    class uring_file_writer final
+    {
+        uring_queue* m_queue;
+        int m_fd = -1;
+        int m_buffer = -1;
+        size_t m_used = 0;
+        uint64_t m_offset = 0;
+
+    public:
+        uring_file_writer(uring_queue* queue, const std::filesystem::path& path);
+        ~uring_file_writer();
+
+        bool is_open() const { return m_fd != -1; }
+        void write(const char* data, size_t size);
+        bool close();
+
+    private:
+        void flush();
+    };
+}
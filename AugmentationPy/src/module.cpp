@@ -0,0 +1,163 @@
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "augmentation/indicators.hpp"
+
+namespace py = pybind11;
+
+namespace program
+{
+    // float64 C-contiguous arrays are used in place, anything else is converted once by NumPy
+    using column = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+    static const char* const s_column_names[] =
+    {
+        "adosc",
+        "atr",
+        "upper_band", "middle_band", "lower_band",
+        "macd", "macd_signal", "macd_hist",
+        "mfi",
+        "rsi"
+    };
+
+    static double** output_column(output_columns& output, const std::string& name)
+    {
+        double** columns[] =
+        {
+            &output.m_adosc,
+            &output.m_atr,
+            &output.m_upper_band, &output.m_middle_band, &output.m_lower_band,
+            &output.m_macd, &output.m_macd_signal, &output.m_macd_hist,
+            &output.m_mfi,
+            &output.m_rsi
+        };
+
+        for (size_t i = 0; i < std::size(s_column_names); i++)
+            if (name == s_column_names[i])
+                return columns[i];
+
+        throw py::value_error("unknown indicator column " + name);
+    }
+
+    // inputs and the NumPy arrays the results are written to, alive until the GIL is taken back
+    struct symbol_arrays
+    {
+        column m_high, m_low, m_close, m_volume;
+        py::dict m_result;
+        indicator_job m_job;
+
+        symbol_arrays(column high, column low, column close, column volume, const std::vector<std::string>& names) :
+            m_high(std::move(high)), m_low(std::move(low)), m_close(std::move(close)), m_volume(std::move(volume))
+        {
+            const py::ssize_t rows = m_close.size();
+            if (m_high.ndim() != 1 || m_low.ndim() != 1 || m_close.ndim() != 1 || m_volume.ndim() != 1)
+                throw py::value_error("expected one dimensional columns");
+            if (m_high.size() != rows || m_low.size() != rows || m_volume.size() != rows)
+                throw py::value_error("all columns need the same length");
+
+            m_job.m_input = { m_high.data(), m_low.data(), m_close.data(), m_volume.data(), (size_t)rows };
+
+            for (const std::string& name : names)
+            {
+                column result(rows);
+                *output_column(m_job.m_output, name) = result.mutable_data();
+                m_result[py::str(name)] = std::move(result);
+            }
+        }
+
+        py::dict result() const
+        {
+            if (m_job.m_status != compute_status::success)
+                throw std::runtime_error(std::string("computing the indicators failed: ") + to_string(m_job.m_status));
+
+            return m_result;
+        }
+    };
+
+    static std::vector<std::string> requested_columns(const py::object& columns)
+    {
+        if (columns.is_none())
+            return { std::begin(s_column_names), std::end(s_column_names) };
+
+        return columns.cast<std::vector<std::string>>();
+    }
+}
+
+PYBIND11_MODULE(augmentation, m)
+{
+    using namespace program;
+
+    m.doc() = "Indicator computation of AugmentationLib on NumPy arrays";
+
+    py::class_<indicator_config>(m, "IndicatorConfig")
+        .def(py::init<>())
+        .def_readwrite("adosc_fast_period", &indicator_config::m_adosc_fast_period)
+        .def_readwrite("adosc_slow_period", &indicator_config::m_adosc_slow_period)
+        .def_readwrite("atr_period", &indicator_config::m_atr_period)
+        .def_readwrite("bbands_period", &indicator_config::m_bbands_period)
+        .def_readwrite("bbands_deviation_up", &indicator_config::m_bbands_deviation_up)
+        .def_readwrite("bbands_deviation_down", &indicator_config::m_bbands_deviation_down)
+        .def_readwrite("macd_fast_period", &indicator_config::m_macd_fast_period)
+        .def_readwrite("macd_slow_period", &indicator_config::m_macd_slow_period)
+        .def_readwrite("macd_signal_period", &indicator_config::m_macd_signal_period)
+        .def_readwrite("mfi_period", &indicator_config::m_mfi_period)
+        .def_readwrite("rsi_period", &indicator_config::m_rsi_period);
+
+    m.attr("COLUMNS") = py::cast(std::vector<std::string>(std::begin(s_column_names), std::end(s_column_names)));
+
+    m.def("compute", [](column high, column low, column close, column volume, const indicator_config& config, const py::object& columns)
+    {
+        symbol_arrays symbol(std::move(high), std::move(low), std::move(close), std::move(volume), requested_columns(columns));
+        {
+            py::gil_scoped_release release;
+            symbol.m_job.m_status = compute_indicators(symbol.m_job.m_input, symbol.m_job.m_output, config);
+        }
+
+        return symbol.result();
+    },
+        "Computes the indicators of one symbol, returns a dict of column name to float64 array.",
+        py::arg("high"), py::arg("low"), py::arg("close"), py::arg("volume"),
+        py::arg("config") = indicator_config{}, py::arg("columns") = py::none());
+
+    m.def("compute_many", [](const py::list& symbols, const indicator_config& config, const py::object& columns, size_t threads)
+    {
+        const std::vector<std::string> names = requested_columns(columns);
+
+        std::vector<symbol_arrays> arrays;
+        arrays.reserve(symbols.size());
+        for (const py::handle& symbol : symbols)
+        {
+            const py::sequence inputs = symbol.cast<py::sequence>();
+            if (inputs.size() != 4)
+                throw py::value_error("expected (high, low, close, volume) per symbol");
+
+            arrays.emplace_back(inputs[0].cast<column>(), inputs[1].cast<column>(), inputs[2].cast<column>(), inputs[3].cast<column>(), names);
+        }
+
+        std::vector<indicator_job> jobs;
+        jobs.reserve(arrays.size());
+        for (const symbol_arrays& symbol : arrays)
+            jobs.push_back(symbol.m_job);
+
+        {
+            py::gil_scoped_release release;
+            compute_indicators(jobs.data(), jobs.size(), config, threads);
+        }
+
+        py::list results;
+        for (size_t i = 0; i < arrays.size(); i++)
+        {
+            arrays[i].m_job.m_status = jobs[i].m_status;
+            results.append(arrays[i].result());
+        }
+
+        return results;
+    },
+        "Computes many symbols in parallel without holding the GIL. Takes a list of (high, low, close, volume) tuples.",
+        py::arg("symbols"), py::arg("config") = indicator_config{}, py::arg("columns") = py::none(), py::arg("threads") = 0);
+}
@@ -15,6 +15,42 @@ workspace "AugmentationCPP"
 
 	CppVersion = "C++17"
 
+	newoption
+	{
+		trigger = "shared-lib",
+		description = "Build AugmentationLib as a shared library instead of a static one"
+	}
+
+	newoption
+	{
+		trigger = "with-python",
+		description = "Also build the AugmentationPy module, needs pybind11 (pip install pybind11)"
+	}
+
+	newoption
+	{
+		trigger = "with-bench",
+		description = "Also build AugmentationBench, the performance regression harness"
+	}
+
+	newoption
+	{
+		trigger = "no-dispatch",
+		description = "Build the vector kernels for the baseline ISA only, without runtime CPU dispatch"
+	}
+
+	-- kernels are cloned per ISA level and picked at load time, so no -march is needed. FMA contraction
+	-- stays off to keep every clone bit identical to the baseline one.
+	function DeclareDispatchOptions()
+		filter "system:linux"
+			buildoptions { "-ffp-contract=off" }
+		filter {}
+
+		if _OPTIONS["no-dispatch"] then
+			defines { "AUGMENTATION_NO_DISPATCH" }
+		end
+	end
+
 	function DeclareMSVCOptions()
 		filter "system:windows"
 		staticruntime "Off"
@@ -49,6 +85,43 @@ workspace "AugmentationCPP"
 			defines { "NDEBUG" }
 	end
 
+	project "AugmentationLib"
+		location "%{prj.name}"
+		kind (_OPTIONS["shared-lib"] and "SharedLib" or "StaticLib")
+		language "C++"
+		cppdialect (CppVersion)
+		pic "On"
+
+		targetdir ("bin/" .. outputdir)
+		objdir ("bin/int/" .. outputdir .. "/%{prj.name}")
+
+		files
+		{
+			"AugmentationCPP/src/augmentation/**.hpp",
+			"AugmentationCPP/src/augmentation/**.cpp"
+		}
+
+		includedirs
+		{
+			"AugmentationCPP/src"
+		}
+
+		libdirs
+		{
+			"bin/lib"
+		}
+
+		links
+		{
+			"ta_lib"
+		}
+
+		DeclareDispatchOptions()
+		DeclareDebugOptions()
+
+		filter "configurations:Release"
+			optimize "speed"
+
 	project "AugmentationCPP"
 		location "%{prj.name}"
 		kind "ConsoleApp"
@@ -68,6 +141,12 @@ workspace "AugmentationCPP"
 			"%{prj.name}/src/**.asm"
 		}
 
+		-- the library sources are built by AugmentationLib
+		removefiles
+		{
+			"%{prj.name}/src/augmentation/**.cpp"
+		}
+
 		includedirs
 		{
 			"%{prj.name}/src"
@@ -80,6 +159,7 @@ workspace "AugmentationCPP"
 
 		links
 		{
+			"AugmentationLib",
 			"pthread",
 			"ta_lib"
 		}
@@ -93,6 +173,7 @@ workspace "AugmentationCPP"
 		}
 
 		-- DeclareMSVCOptions()
+		DeclareDispatchOptions()
 		DeclareDebugOptions()
 
 		flags { "NoImportLib", "Maps" }
@@ -106,3 +187,94 @@ workspace "AugmentationCPP"
 			flags { "LinkTimeOptimization", "NoManifest", "MultiProcessorCompile" }
 			defines { "UGMENTATIONCPP_RELEASE" }
 			optimize "speed"
+
+	if _OPTIONS["with-python"] then
+	project "AugmentationPy"
+		location "%{prj.name}"
+		kind "SharedLib"
+		language "C++"
+		cppdialect (CppVersion)
+		pic "On"
+
+		-- python imports the module as "augmentation"
+		targetname "augmentation"
+		targetprefix ""
+		targetextension (os.outputof("python3-config --extension-suffix"))
+
+		targetdir ("bin/" .. outputdir)
+		objdir ("bin/int/" .. outputdir .. "/%{prj.name}")
+
+		files
+		{
+			"%{prj.name}/src/**.cpp"
+		}
+
+		includedirs
+		{
+			"AugmentationCPP/src"
+		}
+
+		buildoptions
+		{
+			os.outputof("python3 -m pybind11 --includes"),
+			"-fvisibility=hidden"
+		}
+
+		libdirs
+		{
+			"bin/lib"
+		}
+
+		links
+		{
+			"AugmentationLib",
+			"pthread",
+			"ta_lib"
+		}
+
+		DeclareDebugOptions()
+
+		filter "configurations:Release"
+			optimize "speed"
+	end
+
+	if _OPTIONS["with-bench"] then
+	project "AugmentationBench"
+		location "%{prj.name}"
+		kind "ConsoleApp"
+		language "C++"
+		cppdialect (CppVersion)
+
+		targetdir ("bin/" .. outputdir)
+		objdir ("bin/int/" .. outputdir .. "/%{prj.name}")
+
+		files
+		{
+			"%{prj.name}/src/**.hpp",
+			"%{prj.name}/src/**.cpp"
+		}
+
+		includedirs
+		{
+			"AugmentationCPP/src"
+		}
+
+		libdirs
+		{
+			"bin/lib"
+		}
+
+		links
+		{
+			"AugmentationLib",
+			"pthread",
+			"ta_lib"
+		}
+
+		-- same code generation as the targets it measures
+		DeclareDispatchOptions()
+		DeclareDebugOptions()
+
+		filter "configurations:Release"
+			optimize "speed"
+	end